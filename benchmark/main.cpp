@@ -25,16 +25,31 @@
 // SOFTWARE.
 
 #include <dtf/dtf.hpp>
+#include <dtf/dispatch.hpp>
 
+#include <algorithm>
+#include <array>
 #include <iostream>
 #include <sstream>
 #include <iomanip>
 #include <chrono>
+#include <atomic>
+#include <thread>
 #include <cassert>
 #include <cstdint>
 #include <cstdio>
+#include <cstdlib>
 #include <cstring>
 #include <ctime>
+#include <functional>
+#include <queue>
+#include <regex>
+#include <string>
+#include <vector>
+
+#if __cplusplus >= 201703L
+#   include <charconv>
+#endif
 
 #ifdef NDEBUG
 #   error "This file MUST be compiled with NDEBUG undefined!"
@@ -60,7 +75,7 @@ static double bench_ns(std::size_t iters, F &&f) {
 
 /*************************************************************************************************/
 
-int main() {
+static void bench_to_dt_chars() {
     const std::uint64_t base = dtf::timestamp();
     const std::uint64_t base_sec = base - (base % 1000000000ull);
     const std::uint32_t flags =
@@ -132,3 +147,1282 @@ int main() {
 }
 
 /*************************************************************************************************/
+
+static void bench_pattern() {
+    const std::uint64_t base = dtf::timestamp();
+    const std::uint64_t base_sec = base - (base % 1000000000ull);
+
+    std::time_t tt = dtf::to_time_t(base);
+    struct tm tmv;
+    ::gmtime_r(&tt, &tmv);
+
+    const struct {
+        const char *name;
+        const char *fmt;
+    } formats[] = {
+         {"CLF     ", "%d/%b/%Y:%H:%M:%S %z"}
+        ,{"syslog  ", "%b %e %H:%M:%S"}
+        ,{"RFC 1123", "%a, %d %b %Y %H:%M:%S GMT"}
+        ,{"ISO 8601", "%Y-%m-%dT%H:%M:%S"}
+        ,{"verbose ", "%A, %B %e %Y %I:%M:%S %p"}
+    };
+
+    constexpr std::size_t N = 20000000;
+
+    std::cout << std::fixed << std::setprecision(2) << "\n";
+    for ( const auto &it: formats ) {
+        const dtf::pattern pat{it.fmt};
+
+        char sbuf[128];
+        std::strftime(sbuf, sizeof(sbuf), it.fmt, &tmv);
+        const std::string r_pattern = pat.format(base);
+        if ( r_pattern != sbuf ) {
+            std::cout
+                << "dtf::pattern: " << r_pattern << '\n'
+                << "strftime()  : " << sbuf << '\n'
+            ;
+        }
+        assert(r_pattern == sbuf);
+
+        char buf[128];
+        const double pat_hit = bench_ns(N, [&](std::size_t i) {
+            const std::size_t n = pat.format(buf, base_sec + (i % 1000000000ull));
+            do_not_optimize(buf);
+            do_not_optimize(n);
+        });
+
+        const double pat_miss = bench_ns(N, [&](std::size_t i) {
+            const std::size_t n = pat.format(buf, base + i * 1000000000ull);
+            do_not_optimize(buf);
+            do_not_optimize(n);
+        });
+
+        const double strftime_ns = bench_ns(N, [&](std::size_t) {
+            const std::size_t n = std::strftime(buf, sizeof(buf), it.fmt, &tmv);
+            do_not_optimize(buf);
+            do_not_optimize(n);
+        });
+
+        std::cout
+            << it.name << " \"" << r_pattern << "\"\n"
+            << "  pattern  (cache hit) : " << std::setw(6) << pat_hit     << " ns/call\n"
+            << "  pattern  (cache miss): " << std::setw(6) << pat_miss    << " ns/call\n"
+            << "  strftime             : " << std::setw(6) << strftime_ns << " ns/call\n"
+        ;
+    }
+}
+
+/*************************************************************************************************/
+
+static void bench_parse() {
+    const std::uint64_t base = dtf::timestamp();
+
+    const struct {
+        const char *name;
+        const char *fmt;
+    } formats[] = {
+         {"CLF     ", "%d/%b/%Y:%H:%M:%S %z"}
+        ,{"syslog  ", "%b %e %H:%M:%S"}
+        ,{"RFC 1123", "%a, %d %b %Y %H:%M:%S GMT"}
+        ,{"ISO 8601", "%Y-%m-%dT%H:%M:%S"}
+    };
+
+    constexpr std::size_t N = 2000000;
+
+    std::cout << std::fixed << std::setprecision(2) << "\n";
+    for ( const auto &it: formats ) {
+        const dtf::pattern pat{it.fmt};
+
+        // the generated log: one line per 10 ms
+        std::string file;
+        std::vector<std::size_t> lines;
+        lines.reserve(N);
+        for ( std::size_t i = 0; i < N; ++i ) {
+            lines.push_back(file.size());
+            file += pat.format(base + i * 10000000ull);
+            file += " host app[1234]: the message text\n";
+        }
+        const std::size_t ts_len = pat.format(base).size();
+        const double mb = static_cast<double>(file.size()) / (1024.0 * 1024.0);
+
+        std::uint64_t sum_dtf = 0;
+        const double dtf_ns = bench_ns(N, [&](std::size_t i) {
+            std::uint64_t ts{};
+            const auto err = pat.parse(&ts, file.data() + lines[i], ts_len, base);
+            do_not_optimize(err);
+            sum_dtf += ts / 1000000000ull;
+        });
+
+        std::time_t now = dtf::to_time_t(base);
+        struct tm now_tm;
+        ::gmtime_r(&now, &now_tm);
+
+        std::uint64_t sum_strptime = 0;
+        const double strptime_ns = bench_ns(N, [&](std::size_t i) {
+            struct tm tmv{};
+            tmv.tm_year = now_tm.tm_year; // for syslog
+            const char *end = ::strptime(file.data() + lines[i], it.fmt, &tmv);
+            do_not_optimize(end);
+            sum_strptime += static_cast<std::uint64_t>(::timegm(&tmv));
+        });
+
+        // both must produce the same result (the offset of CLF is +0000)
+        assert(sum_dtf == sum_strptime);
+
+        std::cout
+            << it.name << " \"" << pat.format(base) << "\"\n"
+            << "  pattern::parse    : " << std::setw(7) << dtf_ns
+                << " ns/line, " << std::setw(8) << mb * 1e9 / (dtf_ns * N) << " MB/s\n"
+            << "  strptime + timegm : " << std::setw(7) << strptime_ns
+                << " ns/line, " << std::setw(8) << mb * 1e9 / (strptime_ns * N) << " MB/s\n"
+        ;
+    }
+}
+
+/*************************************************************************************************/
+
+template<typename F>
+static double bench_threads_ns(std::size_t num_threads, std::size_t iters, F &&f) {
+    std::vector<std::thread> threads;
+    std::atomic<bool> start{false};
+    const auto beg = std::chrono::steady_clock::now();
+    for ( std::size_t t = 0; t < num_threads; ++t ) {
+        threads.emplace_back([&, t]() {
+            while ( !start.load() ) {}
+            for ( std::size_t i = 0; i < iters; ++i ) {
+                f(t, i);
+            }
+        });
+    }
+    start = true;
+    for ( auto &it: threads ) {
+        it.join();
+    }
+    const auto end = std::chrono::steady_clock::now();
+
+    // the wall time per call of single thread
+    return std::chrono::duration<double, std::nano>(end - beg).count() / static_cast<double>(iters);
+}
+
+static void bench_http_date() {
+    const std::uint64_t base = dtf::timestamp();
+
+    char sbuf[64];
+    std::time_t tt = dtf::to_time_t(base);
+    struct tm tmv;
+    ::gmtime_r(&tt, &tmv);
+    std::strftime(sbuf, sizeof(sbuf), "%a, %d %b %Y %H:%M:%S GMT", &tmv);
+    assert(dtf::to_http_date_str(base) == sbuf);
+    std::cout << "\n" << sbuf << "\n";
+
+    constexpr std::size_t N = 10000000;
+    // the new second every 100000 calls
+    constexpr std::uint64_t step = 10000ull;
+
+    dtf::http_date_cache cache;
+
+    std::cout << std::fixed << std::setprecision(2);
+    for ( const std::size_t num_threads: {1u, 2u, 4u, 8u} ) {
+        const double shared_ns = bench_threads_ns(num_threads, N, [&](std::size_t, std::size_t i) {
+            char buf[dtf::http_date_size];
+            dtf::to_http_date_chars(buf, base + i * step, cache);
+            do_not_optimize(buf);
+        });
+
+        const double tls_ns = bench_threads_ns(num_threads, N, [&](std::size_t, std::size_t i) {
+            char buf[dtf::http_date_size];
+            dtf::to_http_date_chars(buf, base + i * step);
+            do_not_optimize(buf);
+        });
+
+        const double strftime_ns = bench_threads_ns(num_threads, N / 10, [&](std::size_t, std::size_t i) {
+            char buf[64];
+            std::time_t t = dtf::to_time_t(base + i * step);
+            struct tm tmv;
+            ::gmtime_r(&t, &tmv);
+            const std::size_t n = std::strftime(buf, sizeof(buf), "%a, %d %b %Y %H:%M:%S GMT", &tmv);
+            do_not_optimize(buf);
+            do_not_optimize(n);
+        });
+
+        std::cout
+            << num_threads << " thread(s), wall time per call:\n"
+            << "  to_http_date_chars (shared cache)  : " << std::setw(7) << shared_ns   << " ns/call\n"
+            << "  to_http_date_chars (thread_local)  : " << std::setw(7) << tls_ns      << " ns/call\n"
+            << "  gmtime_r + strftime                : " << std::setw(7) << strftime_ns << " ns/call\n"
+        ;
+    }
+}
+
+static void bench_rfc3339() {
+    const std::uint64_t base = dtf::timestamp();
+    constexpr auto flags = dtf::yyyy_mm_dd|dtf::date_sep_dash|dtf::dt_sep_T|dtf::time_sep_colon|dtf::msecs;
+    constexpr int offset = 5 * 60 + 30;
+
+    constexpr std::size_t N = 10000000;
+
+    const double z_ns = bench_ns(N, [&](std::size_t i) {
+        char buf[dtf::bufsize];
+        const auto n = dtf::to_dt_chars(buf, base + i, flags | dtf::zone_Z);
+        do_not_optimize(buf);
+        do_not_optimize(n);
+    });
+    const double offset_ns = bench_ns(N, [&](std::size_t i) {
+        char buf[dtf::bufsize];
+        const auto n = dtf::to_dt_chars(buf, base + i, flags | dtf::zone_offset, offset);
+        do_not_optimize(buf);
+        do_not_optimize(n);
+    });
+    const double memcpy_ns = bench_ns(N, [&](std::size_t i) {
+        char buf[dtf::bufsize];
+        auto n = dtf::to_dt_chars(buf, base + i + offset * 60ull * 1000000000ull, flags);
+        std::memcpy(buf + n, "+05:30", 6);
+        n += 6;
+        do_not_optimize(buf);
+        do_not_optimize(n);
+    });
+    const double concat_ns = bench_ns(N, [&](std::size_t i) {
+        std::string s = dtf::to_dt_str(base + i + offset * 60ull * 1000000000ull, flags) + "+05:30";
+        do_not_optimize(s);
+    });
+
+    std::cout << std::fixed << std::setprecision(2)
+        << "to_dt_chars(zone_Z)              : " << std::setw(7) << z_ns      << " ns/call\n"
+        << "to_dt_chars(zone_offset, +05:30) : " << std::setw(7) << offset_ns << " ns/call\n"
+        << "to_dt_chars + memcpy(\"+05:30\")   : " << std::setw(7) << memcpy_ns << " ns/call\n"
+        << "to_dt_str + \"+05:30\"             : " << std::setw(7) << concat_ns << " ns/call\n"
+    ;
+}
+
+// consumes all the fields instead of spilling the whole struct to the stack
+static inline void do_not_optimize_fields(const dtf::fields &f) {
+    do_not_optimize(f.year + f.month + f.day + f.hours + f.mins + f.secs + f.nsecs + f.wday + f.yday);
+}
+
+static inline void do_not_optimize_fields(const struct tm &tmv) {
+    do_not_optimize(tmv.tm_year + tmv.tm_mon + tmv.tm_mday + tmv.tm_hour + tmv.tm_min + tmv.tm_sec
+        + tmv.tm_wday + tmv.tm_yday);
+}
+
+static void bench_fields() {
+    const std::uint64_t base = dtf::timestamp();
+
+    constexpr std::size_t N = 10000000;
+
+    const double to_fields_ns = bench_ns(N, [&](std::size_t i) {
+        // the same second for 1000 calls in a row, as a typical logger does
+        const dtf::fields f = dtf::to_fields(base + i * 1000000ull);
+        do_not_optimize_fields(f);
+    });
+    const double to_fields_uniq_ns = bench_ns(N, [&](std::size_t i) {
+        const dtf::fields f = dtf::to_fields(base + i * 1000000000ull);
+        do_not_optimize_fields(f);
+    });
+    const double gmtime_ns = bench_ns(N, [&](std::size_t i) {
+        const std::time_t t = dtf::to_time_t(base + i * 1000000ull);
+        struct tm tmv;
+        ::gmtime_r(&t, &tmv);
+        do_not_optimize_fields(tmv);
+    });
+
+    std::vector<dtf::fields> fields(1024);
+    std::vector<struct tm> tms(fields.size());
+    for ( std::size_t i = 0; i < fields.size(); ++i ) {
+        const std::uint64_t ts = base + i * 3600ull * 1000000000ull;
+        fields[i] = dtf::to_fields(ts);
+        const std::time_t t = dtf::to_time_t(ts);
+        ::gmtime_r(&t, &tms[i]);
+    }
+    const std::size_t mask = fields.size() - 1;
+
+    const double from_fields_ns = bench_ns(N, [&](std::size_t i) {
+        const std::uint64_t ts = dtf::from_fields(fields[i & mask]);
+        do_not_optimize(ts);
+    });
+    const double timegm_ns = bench_ns(N, [&](std::size_t i) {
+        const std::time_t t = ::timegm(&tms[i & mask]);
+        do_not_optimize(t);
+    });
+
+    std::cout << std::fixed << std::setprecision(2)
+        << "to_fields (same second)   : " << std::setw(7) << to_fields_ns      << " ns/call\n"
+        << "to_fields (new second)    : " << std::setw(7) << to_fields_uniq_ns << " ns/call\n"
+        << "gmtime_r                  : " << std::setw(7) << gmtime_ns         << " ns/call\n"
+        << "from_fields (new day)     : " << std::setw(7) << from_fields_ns    << " ns/call\n"
+        << "timegm                    : " << std::setw(7) << timegm_ns         << " ns/call\n"
+    ;
+}
+
+static void bench_buckets() {
+    const std::uint64_t base = dtf::timestamp();
+
+    // the sorted timestamps 37ms apart, ~4.3 days in total
+    constexpr std::size_t N = 10000000;
+    std::vector<std::uint64_t> src(N), dst(N);
+    for ( std::size_t i = 0; i < N; ++i ) {
+        src[i] = base + i * 37000000ull;
+    }
+
+    static const struct {
+        const char *name;
+        dtf::unit unit;
+    } units[] = {
+         {"minute", dtf::unit_minute}
+        ,{"hour  ", dtf::unit_hour}
+        ,{"day   ", dtf::unit_day}
+        ,{"week  ", dtf::unit_week}
+        ,{"month ", dtf::unit_month}
+    };
+
+    std::cout << std::fixed << std::setprecision(2);
+    for ( const auto &it: units ) {
+        const double single_ns = bench_ns(N, [&](std::size_t i) {
+            dst[i] = dtf::floor_to(it.unit, src[i]);
+        });
+        do_not_optimize(dst.data());
+
+        const double batch_ns = bench_ns(1, [&](std::size_t) {
+            dtf::floor_to(it.unit, dst.data(), src.data(), N);
+        }) / N;
+        do_not_optimize(dst.data());
+
+        std::cout
+            << it.name << ": floor_to " << std::setw(6) << single_ns << " ns/ts"
+            << ", batch " << std::setw(6) << batch_ns << " ns/ts"
+            << " (" << std::setw(7) << 1e3 / batch_ns << " M ts/s)\n"
+        ;
+    }
+
+    // truncation to the month via `struct tm`
+    const double libc_ns = bench_ns(N / 10, [&](std::size_t i) {
+        std::time_t t = dtf::to_time_t(src[i]);
+        struct tm tmv;
+        ::gmtime_r(&t, &tmv);
+        tmv.tm_mday = 1;
+        tmv.tm_hour = tmv.tm_min = tmv.tm_sec = 0;
+        dst[i] = dtf::from_time_t(::timegm(&tmv));
+    });
+    do_not_optimize(dst.data());
+
+    std::cout << "month : gmtime_r + timegm " << std::setw(6) << libc_ns << " ns/ts\n";
+}
+
+template<std::size_t N>
+static void bench_civil_cache_size(const std::vector<std::uint32_t> &secs) {
+    static thread_local dtf::civil_cache<N> cache{};
+    cache = dtf::civil_cache<N>{};
+
+    std::size_t hits = 0;
+    const double ns = bench_ns(secs.size(), [&](std::size_t i) {
+        bool hit;
+        const dtf::civil_time &ct = cache.get(secs[i], &hit);
+        hits += hit;
+        do_not_optimize(ct.secs);
+    });
+
+    std::cout
+        << "  N=" << std::setw(2) << N << ": hit rate " << std::setw(6) << 100.0 * hits / secs.size() << "%"
+        << ", " << std::setw(5) << ns << " ns/call\n"
+    ;
+}
+
+static void bench_civil_cache() {
+    const std::uint32_t base = static_cast<std::uint32_t>(dtf::timestamp() / 1000000000ull);
+
+    constexpr std::size_t N = 10000000;
+    constexpr auto flags = dtf::yyyy_mm_dd|dtf::date_sep_dash|dtf::dt_sep_T|dtf::time_sep_colon|dtf::usecs;
+
+    std::cout << std::fixed << std::setprecision(2);
+    for ( const std::uint32_t k: {1u, 2u, 3u, 4u, 6u, 8u, 12u, 16u} ) {
+        // `k` feeds, each one lagging the previous by ~1 minute, the events are interleaved
+        // round-robin and each feed advances by one second every 1000 events
+        std::vector<std::uint32_t> secs(N);
+        for ( std::size_t i = 0; i < N; ++i ) {
+            secs[i] = base + static_cast<std::uint32_t>((i % k) * 61u + i / (k * 1000u));
+        }
+
+        std::cout << k << " source(s):\n";
+        bench_civil_cache_size<1>(secs);
+        bench_civil_cache_size<4>(secs);
+        bench_civil_cache_size<8>(secs);
+        bench_civil_cache_size<16>(secs);
+
+        const double dt_ns = bench_ns(N, [&](std::size_t i) {
+            char buf[dtf::bufsize];
+            const auto n = dtf::to_dt_chars(buf, secs[i] * 1000000000ull + i, flags);
+            do_not_optimize(buf);
+            do_not_optimize(n);
+        });
+        std::cout << "  to_dt_chars (DTF_CIVIL_CACHE_SIZE=" << DTF_CIVIL_CACHE_SIZE << "): " << std::setw(5) << dt_ns << " ns/call\n";
+    }
+}
+
+static void bench_context() {
+    const std::uint64_t base = dtf::timestamp();
+    constexpr auto flags = dtf::yyyy_mm_dd|dtf::date_sep_dash|dtf::dt_sep_T|dtf::time_sep_colon|dtf::usecs;
+
+    constexpr std::size_t N = 10000000;
+
+    std::cout << std::fixed << std::setprecision(2);
+    // the same second for 1000 calls in a row, the new second every call
+    for ( const std::uint64_t step: {1000000ull, 1000000000ull} ) {
+        const double tls_ns = bench_ns(N, [&](std::size_t i) {
+            char buf[dtf::bufsize];
+            const auto n = dtf::to_dt_chars(buf, base + i * step, flags);
+            do_not_optimize(buf);
+            do_not_optimize(n);
+        });
+
+        dtf::context ctx;
+        const double ctx_ns = bench_ns(N, [&](std::size_t i) {
+            char buf[dtf::bufsize];
+            const auto n = dtf::to_dt_chars(buf, base + i * step, flags, ctx);
+            do_not_optimize(buf);
+            do_not_optimize(n);
+        });
+
+        const double nocache_ns = bench_ns(N, [&](std::size_t i) {
+            char buf[dtf::bufsize];
+            const auto n = dtf::to_dt_chars(buf, base + i * step, flags, dtf::no_cache);
+            do_not_optimize(buf);
+            do_not_optimize(n);
+        });
+
+        std::cout
+            << (step == 1000000ull ? "the same second:\n" : "the new second every call:\n")
+            << "  thread_local : " << std::setw(6) << tls_ns     << " ns/call\n"
+            << "  dtf::context : " << std::setw(6) << ctx_ns     << " ns/call\n"
+            << "  dtf::no_cache: " << std::setw(6) << nocache_ns << " ns/call\n"
+        ;
+    }
+}
+
+static void bench_from_chars() {
+    const std::uint64_t base = dtf::timestamp();
+
+    // the different numbers of the same length in the one buffer, as in the batch of messages.
+    // the set fits into L1/L2, so the parsing itself is measured
+    constexpr std::size_t M = 4096;
+    constexpr std::size_t N = 10000000;
+    std::cout << std::fixed << std::setprecision(2);
+    for ( const std::uint32_t f: {dtf::secs, dtf::msecs, dtf::nsecs} ) {
+        std::vector<char> arena(M * dtf::bufsize);
+        std::vector<const char *> bufs(M);
+        std::vector<std::size_t> lens(M);
+        for ( std::size_t i = 0; i < M; ++i ) {
+            bufs[i] = &arena[i * dtf::bufsize];
+            lens[i] = dtf::to_chars(&arena[i * dtf::bufsize], base + i * 1234567891ull, f);
+            arena[i * dtf::bufsize + lens[i]] = '\0';
+        }
+        std::vector<std::uint64_t> res(M);
+
+        const double dtf_ns = bench_ns(N, [&](std::size_t i) {
+            const auto err = dtf::from_chars(&res[i % M], bufs[i % M], lens[i % M], f);
+            do_not_optimize(err);
+        });
+        const double batch_ns = bench_ns(N / M, [&](std::size_t) {
+            const auto n = dtf::from_chars(res.data(), bufs.data(), lens.data(), M, f);
+            do_not_optimize(n);
+        }) / M;
+        const double strtoull_ns = bench_ns(N, [&](std::size_t i) {
+            char *end;
+            res[i % M] = std::strtoull(bufs[i % M], &end, 10);
+            do_not_optimize(end);
+        });
+#if __cplusplus >= 201703L
+        const double std_ns = bench_ns(N, [&](std::size_t i) {
+            const auto r = std::from_chars(bufs[i % M], bufs[i % M] + lens[i % M], res[i % M]);
+            do_not_optimize(r.ptr);
+        });
+#endif
+
+        std::cout
+            << lens[0] << " digits:\n"
+            << "  dtf::from_chars        : " << std::setw(6) << dtf_ns      << " ns/call\n"
+            << "  dtf::from_chars (batch): " << std::setw(6) << batch_ns    << " ns/call\n"
+            << "  strtoull               : " << std::setw(6) << strtoull_ns << " ns/call\n"
+#if __cplusplus >= 201703L
+            << "  std::from_chars        : " << std::setw(6) << std_ns      << " ns/call\n"
+#endif
+        ;
+    }
+}
+
+static void bench_dispatch() {
+    const std::uint64_t base = dtf::timestamp();
+
+    // all the valid flags combinations
+    std::vector<std::uint32_t> all;
+    for ( std::uint32_t f = 0; f < (1u << 20); ++f ) {
+        if ( dtf::get_formatter(f) ) {
+            all.push_back(f);
+        }
+    }
+    std::cout << all.size() << " flags combinations\n";
+
+    constexpr std::size_t M = 4096;
+    constexpr std::size_t N = 10000000;
+    std::uint64_t seed = 0x2545F4914F6CDD1Dull;
+    const auto next_rand = [&seed]() {
+        seed ^= seed << 13;
+        seed ^= seed >> 7;
+        seed ^= seed << 17;
+        return seed;
+    };
+
+    std::cout << std::fixed << std::setprecision(2);
+    // the random flags for every call, chosen from the pool of `pool_size` combinations
+    for ( const std::size_t pool_size: {1u, 4u, 16u, 64u, 936u} ) {
+        std::vector<std::uint32_t> pool(pool_size);
+        for ( auto &it: pool ) {
+            it = all[next_rand() % all.size()];
+        }
+        std::vector<std::uint32_t> flags(M);
+        for ( auto &it: flags ) {
+            it = pool[next_rand() % pool.size()];
+        }
+
+        const double generic_ns = bench_ns(N, [&](std::size_t i) {
+            char buf[dtf::bufsize];
+            const auto n = dtf::to_dt_chars(buf, base + i, flags[i % M]);
+            do_not_optimize(buf);
+            do_not_optimize(n);
+        });
+        const double dispatch_ns = bench_ns(N, [&](std::size_t i) {
+            char buf[dtf::bufsize];
+            const auto n = dtf::to_dt_chars_dispatch(buf, base + i, flags[i % M]);
+            do_not_optimize(buf);
+            do_not_optimize(n);
+        });
+
+        std::cout
+            << std::setw(3) << pool_size << " flags set(s): "
+            << "to_dt_chars " << std::setw(6) << generic_ns << " ns/call, "
+            << "to_dt_chars_dispatch " << std::setw(6) << dispatch_ns << " ns/call\n"
+        ;
+    }
+}
+
+/*************************************************************************************************/
+
+static void bench_column() {
+    const std::uint64_t base = dtf::timestamp();
+    constexpr auto flags = dtf::yyyy_mm_dd|dtf::date_sep_dash|dtf::dt_sep_T|dtf::time_sep_colon|dtf::usecs;
+
+    // the batch of rows about one millisecond apart
+    constexpr std::size_t rows = 4096;
+    constexpr std::size_t N = 2000;
+    std::vector<std::uint64_t> tss(rows);
+    for ( std::size_t i = 0; i < rows; ++i ) {
+        tss[i] = base + i * 1000003ull;
+    }
+
+    const std::size_t len = dtf::dt_chars_size(flags);
+    std::vector<char> data(rows * len);
+    std::vector<std::int32_t> offsets32(rows + 1);
+    std::vector<std::int64_t> offsets64(rows + 1);
+
+    // the row by row builder: format into the temporary buffer, then copy and append the offset
+    const double rowwise_ns = bench_ns(N, [&](std::size_t) {
+        std::int32_t pos = 0;
+        offsets32[0] = 0;
+        for ( std::size_t i = 0; i < rows; ++i ) {
+            char buf[dtf::bufsize];
+            const auto n = dtf::to_dt_chars(buf, tss[i], flags);
+            std::memcpy(data.data() + pos, buf, n);
+            pos += static_cast<std::int32_t>(n);
+            offsets32[i + 1] = pos;
+        }
+        do_not_optimize(data.data());
+    });
+    const double strings_ns = bench_ns(N, [&](std::size_t) {
+        std::vector<std::string> column;
+        column.reserve(rows);
+        for ( std::size_t i = 0; i < rows; ++i ) {
+            column.push_back(dtf::to_dt_str(tss[i], flags));
+        }
+        do_not_optimize(column.data());
+    });
+    const double column32_ns = bench_ns(N, [&](std::size_t) {
+        offsets32[0] = 0;
+        const auto n = dtf::to_dt_column(data.data(), offsets32.data(), tss.data(), rows, flags);
+        do_not_optimize(data.data());
+        do_not_optimize(n);
+    });
+    const double column64_ns = bench_ns(N, [&](std::size_t) {
+        offsets64[0] = 0;
+        const auto n = dtf::to_dt_column(data.data(), offsets64.data(), tss.data(), rows, flags);
+        do_not_optimize(data.data());
+        do_not_optimize(n);
+    });
+
+    const auto rows_per_sec = [](double ns) {
+        return static_cast<double>(rows) * 1e9 / ns / 1e6;
+    };
+    std::cout << std::fixed << std::setprecision(2)
+        << "row by row + copy       : " << std::setw(7) << rows_per_sec(rowwise_ns) << " M rows/s\n"
+        << "std::vector<std::string>: " << std::setw(7) << rows_per_sec(strings_ns) << " M rows/s\n"
+        << "to_dt_column, int32     : " << std::setw(7) << rows_per_sec(column32_ns) << " M rows/s\n"
+        << "to_dt_column, int64     : " << std::setw(7) << rows_per_sec(column64_ns) << " M rows/s\n"
+    ;
+}
+
+/*************************************************************************************************/
+
+static void bench_wall_mapper() {
+    constexpr std::size_t N = 10000000;
+    dtf::wall_mapper mapper;
+
+    const double timestamp_ns = bench_ns(N, [&](std::size_t) {
+        do_not_optimize(dtf::timestamp());
+    });
+    const double steady_ns = bench_ns(N, [&](std::size_t) {
+        do_not_optimize(dtf::wall_mapper::steady_now());
+    });
+    const double now_ns = bench_ns(N, [&](std::size_t) {
+        do_not_optimize(mapper.now());
+    });
+    // the readings are taken by the capture, only the mapping is done here
+    const std::uint64_t mono = dtf::wall_mapper::steady_now();
+    const double to_wall_ns = bench_ns(N, [&](std::size_t i) {
+        do_not_optimize(mapper.to_wall(mono + i));
+    });
+    const double resample_ns = bench_ns(N / 100, [&](std::size_t) {
+        do_not_optimize(mapper.resample());
+    });
+
+    std::cout << std::fixed << std::setprecision(2)
+        << "dtf::timestamp()          : " << std::setw(6) << timestamp_ns << " ns/call\n"
+        << "steady_clock::now()       : " << std::setw(6) << steady_ns << " ns/call\n"
+        << "wall_mapper::now()        : " << std::setw(6) << now_ns << " ns/call\n"
+        << "wall_mapper::to_wall()    : " << std::setw(6) << to_wall_ns << " ns/call\n"
+        << "wall_mapper::resample()   : " << std::setw(6) << resample_ns << " ns/call\n"
+        << "max error 1 s after sample: " << std::setw(6)
+            << static_cast<double>(mapper.max_error(mono + 1000000000ull)) / 1000.0 << " us\n"
+    ;
+}
+
+/*************************************************************************************************/
+
+static void bench_prefix() {
+    const std::uint64_t base = dtf::timestamp();
+    const std::uint32_t formats[] = {
+         dtf::dd_mm_yyyy|dtf::date_sep_point|dtf::dt_sep_space|dtf::time_sep_colon|dtf::secs
+        ,dtf::yyyy_mm_dd|dtf::date_sep_empty|dtf::dt_sep_T|dtf::time_sep_empty|dtf::secs
+        ,dtf::yyyy_mm_dd|dtf::date_sep_dash|dtf::dt_sep_T|dtf::time_sep_colon|dtf::msecs|dtf::zone_Z
+    };
+
+    // the log lines in the mapped file: not terminated after the date-time
+    constexpr std::size_t N = 1000000;
+    std::string file;
+    std::vector<std::size_t> lines;
+    lines.reserve(N);
+    for ( std::size_t i = 0; i < N; ++i ) {
+        lines.push_back(file.size());
+        char buf[dtf::bufsize];
+        file.append(buf, dtf::to_dt_chars(buf, base + i * 10000000ull, formats[(i / 16) % 3]));
+        file += " host app[1234]: the message text\n";
+    }
+    const std::size_t len = dtf::dt_chars_size(formats[1]); // the shortest
+    const std::size_t max_len = dtf::dt_chars_size(formats[2]);
+
+    // the way it was done before: the candidate copied into the terminated string
+    std::size_t found_copy = 0;
+    const double copy_ns = bench_ns(N, [&](std::size_t i) {
+        const char *line = file.data() + lines[i];
+        for ( std::size_t n = max_len; n >= len; --n ) {
+            std::uint32_t flags;
+            const std::string candidate{line, n};
+            if ( dtf::get_flags(&flags, candidate) == dtf::error::ok ) {
+                ++found_copy;
+                break;
+            }
+        }
+    });
+
+    std::size_t found_prefix = 0;
+    const double prefix_ns = bench_ns(N, [&](std::size_t i) {
+        std::uint32_t flags;
+        std::size_t consumed;
+#if __cplusplus >= 201703L
+        const std::string_view line{file.data() + lines[i], file.size() - lines[i]};
+        const auto err = dtf::get_flags_prefix(&flags, &consumed, line);
+#else
+        const auto err = dtf::get_flags_prefix(&flags, &consumed, file.data() + lines[i], file.size() - lines[i]);
+#endif // __cplusplus >= 201703L
+        found_prefix += err == dtf::error::ok;
+        do_not_optimize(consumed);
+    });
+    assert(found_copy == N && found_prefix == N);
+
+    std::cout << std::fixed << std::setprecision(2)
+        << "copy + get_flags()  : " << std::setw(7) << copy_ns << " ns/line\n"
+        << "get_flags_prefix()  : " << std::setw(7) << prefix_ns << " ns/line\n"
+    ;
+}
+
+/*************************************************************************************************/
+
+static void bench_find_dt() {
+    const std::uint64_t base = dtf::timestamp();
+    const std::uint32_t formats[] = {
+         dtf::yyyy_mm_dd|dtf::date_sep_dash|dtf::dt_sep_T|dtf::time_sep_colon|dtf::msecs
+        ,dtf::dd_mm_yyyy|dtf::date_sep_point|dtf::dt_sep_space|dtf::time_sep_colon|dtf::secs
+        ,dtf::yyyy_mm_dd|dtf::date_sep_empty|dtf::dt_sep_T|dtf::time_sep_empty|dtf::secs
+    };
+
+    // the date-time is in the middle of the line, after the numbers looking alike
+    constexpr std::size_t lines = 40000;
+    std::string text;
+    for ( std::size_t i = 0; i < lines; ++i ) {
+        text += "[INFO] host=10.0.0.1:51234 pid=1234 req=12-34-5678 ";
+        char buf[dtf::bufsize];
+        text.append(buf, dtf::to_dt_chars(buf, base + i * 10000000ull, formats[(i / 16) % 3]));
+        text += " took 15.250 ms\n";
+    }
+
+    const auto scan = [&text](std::size_t *found, const auto &find) {
+        *found = 0;
+        for ( std::size_t pos = 0; pos < text.size(); ) {
+            std::size_t len;
+            const std::size_t n = text.size() - pos;
+            const std::size_t off = find(text.data() + pos, n, &len);
+            if ( off == n ) {
+                break;
+            }
+            ++*found;
+            pos += off + len;
+        }
+    };
+
+    std::size_t found_dt = 0;
+    const double find_dt_ns = bench_ns(10, [&](std::size_t) {
+        scan(&found_dt, [](const char *p, std::size_t n, std::size_t *len) {
+            std::uint32_t flags;
+            return dtf::find_dt(p, n, len, &flags);
+        });
+    });
+
+    // every kernel supported here, the selected one is used by `find_dt()`
+    double kernel_ns[dtf::simd_avx512 + 1] = {};
+    for ( std::uint32_t level = dtf::simd_scalar; level <= dtf::get_simd_level(); ++level ) {
+        std::size_t found = 0;
+        kernel_ns[level] = bench_ns(10, [&](std::size_t) {
+            scan(&found, [level](const char *p, std::size_t n, std::size_t *len) {
+                std::uint32_t flags;
+                return dtf::find_dt_with(static_cast<dtf::simd_level>(level), p, n, len, &flags);
+            });
+        });
+        assert(found == lines);
+    }
+
+    // `get_flags_prefix()` at every position
+    std::size_t found_prefix = 0;
+    const double prefix_ns = bench_ns(10, [&](std::size_t) {
+        scan(&found_prefix, [](const char *p, std::size_t n, std::size_t *len) {
+            std::uint32_t flags;
+            for ( std::size_t i = 0; i < n; ++i ) {
+                if ( dtf::get_flags_prefix(&flags, len, p + i, n - i) == dtf::error::ok ) {
+                    return i;
+                }
+            }
+            return n;
+        });
+    });
+
+    const std::regex re{
+        R"((\d{4}[-.]\d{2}[-.]\d{2}|\d{2}[-.]\d{2}[-.]\d{4}|\d{8})[Tt _/-]\d{2}[:.]?\d{2}[:.]?\d{2}(\.\d{3,9})?(Z|[+-]\d{2}:\d{2})?)"
+        ,std::regex::optimize
+    };
+    std::size_t found_regex = 0;
+    const double regex_ns = bench_ns(1, [&](std::size_t) {
+        found_regex = static_cast<std::size_t>(std::distance(
+             std::cregex_iterator{text.data(), text.data() + text.size(), re}
+            ,std::cregex_iterator{}
+        ));
+    });
+    assert(found_dt == lines && found_prefix == lines && found_regex == lines);
+
+    const auto gbps = [&text](double ns) {
+        return static_cast<double>(text.size()) / ns;
+    };
+    std::cout << std::fixed << std::setprecision(3)
+        << "std::regex               : " << std::setw(7) << gbps(regex_ns) << " GB/s\n"
+        << "get_flags_prefix() at all: " << std::setw(7) << gbps(prefix_ns) << " GB/s\n"
+        << "find_dt()                : " << std::setw(7) << gbps(find_dt_ns) << " GB/s ("
+            << dtf::simd_level_name(dtf::get_simd_level()) << ")\n"
+    ;
+    for ( std::uint32_t level = dtf::simd_scalar; level <= dtf::get_simd_level(); ++level ) {
+        const char *name = dtf::simd_level_name(static_cast<dtf::simd_level>(level));
+        std::cout
+            << "  " << name << std::setw(static_cast<int>(25 - std::strlen(name))) << ": "
+            << std::setw(7) << gbps(kernel_ns[level]) << " GB/s\n"
+        ;
+    }
+}
+
+/*************************************************************************************************/
+
+static void bench_tables() {
+    constexpr auto flags = dtf::yyyy_mm_dd|dtf::date_sep_dash|dtf::dt_sep_T|dtf::time_sep_colon|dtf::usecs|dtf::zone_Z;
+    const std::uint64_t base = dtf::timestamp();
+
+    // the first call builds the tables of the style
+    char buf[dtf::bufsize];
+    const auto start = std::chrono::steady_clock::now();
+    dtf::to_dt_chars(buf, base, flags, dtf::tables);
+    const std::chrono::duration<double, std::micro> warmup = std::chrono::steady_clock::now() - start;
+    const std::size_t memory = dtf::tables_memory();
+
+    // the random timestamps within a year, so both the conversion cache and the tables are cold
+    constexpr std::size_t N = 1 << 22;
+    std::vector<std::uint64_t> tss(N);
+    std::uint64_t seed = 0x9E3779B97F4A7C15ull;
+    for ( auto &it: tss ) {
+        seed ^= seed << 13;
+        seed ^= seed >> 7;
+        seed ^= seed << 17;
+        it = base - seed % (365ull * 86400ull * 1000000000ull);
+    }
+
+    const double cached_ns = bench_ns(N, [&](std::size_t i) {
+        do_not_optimize(dtf::to_dt_chars(buf, tss[i], flags));
+        do_not_optimize(buf);
+    });
+    const double no_cache_ns = bench_ns(N, [&](std::size_t i) {
+        do_not_optimize(dtf::to_dt_chars(buf, tss[i], flags, dtf::no_cache));
+        do_not_optimize(buf);
+    });
+    const double tables_ns = bench_ns(N, [&](std::size_t i) {
+        do_not_optimize(dtf::to_dt_chars(buf, tss[i], flags, dtf::tables));
+        do_not_optimize(buf);
+    });
+    // the sequential timestamps, the conversion cache hits
+    const double seq_cached_ns = bench_ns(N, [&](std::size_t i) {
+        do_not_optimize(dtf::to_dt_chars(buf, base + i * 1000003ull, flags));
+        do_not_optimize(buf);
+    });
+    const double seq_tables_ns = bench_ns(N, [&](std::size_t i) {
+        do_not_optimize(dtf::to_dt_chars(buf, base + i * 1000003ull, flags, dtf::tables));
+        do_not_optimize(buf);
+    });
+
+    std::cout << std::fixed << std::setprecision(2)
+        << "tables memory            : " << std::setw(7) << static_cast<double>(memory) / 1024.0 << " KiB\n"
+        << "tables warm-up           : " << std::setw(7) << warmup.count() << " us\n"
+        << "random, to_dt_chars()    : " << std::setw(7) << cached_ns << " ns/call\n"
+        << "random, dtf::no_cache    : " << std::setw(7) << no_cache_ns << " ns/call\n"
+        << "random, dtf::tables      : " << std::setw(7) << tables_ns << " ns/call\n"
+        << "sequential, to_dt_chars(): " << std::setw(7) << seq_cached_ns << " ns/call\n"
+        << "sequential, dtf::tables  : " << std::setw(7) << seq_tables_ns << " ns/call\n"
+    ;
+}
+
+/*************************************************************************************************/
+
+static void bench_calendar() {
+    const std::uint64_t base = dtf::timestamp();
+
+    // the schedule entries: random times within ~10 years, and the sorted ones 1 hour apart
+    constexpr std::size_t N = 4000000;
+    std::vector<std::uint64_t> random(N), sorted(N), dst(N);
+    std::uint64_t seed = 0x9E3779B97F4A7C15ull;
+    for ( std::size_t i = 0; i < N; ++i ) {
+        seed ^= seed << 13;
+        seed ^= seed >> 7;
+        seed ^= seed << 17;
+        random[i] = base - seed % (3650ull * 86400ull * 1000000000ull);
+        sorted[i] = base + i * 3600ull * 1000000000ull;
+    }
+
+    // "the same time next month" via `struct tm`, the day is clamped the same way
+    const auto libc_add_months = [](std::uint64_t ts, int months) {
+        std::time_t t = dtf::to_time_t(ts);
+        struct tm tmv;
+        ::gmtime_r(&t, &tmv);
+        const int mon = tmv.tm_mon + months;
+        tmv.tm_year += mon / 12 - (mon % 12 < 0);
+        tmv.tm_mon = (mon % 12 + 12) % 12;
+        const auto dim = static_cast<int>(dtf::days_in_month(tmv.tm_year + 1900u, tmv.tm_mon + 1u));
+        tmv.tm_mday = std::min(tmv.tm_mday, dim);
+        return dtf::from_time_t(::timegm(&tmv)) + ts % 1000000000ull;
+    };
+    const auto libc_next_weekday = [](std::uint64_t ts, int wday) {
+        std::time_t t = dtf::to_time_t(ts);
+        struct tm tmv;
+        ::gmtime_r(&t, &tmv);
+        tmv.tm_mday += (wday - tmv.tm_wday + 6) % 7 + 1;
+        return dtf::from_time_t(::timegm(&tmv)) + ts % 1000000000ull;
+    };
+
+    const double libc_months_ns = bench_ns(N, [&](std::size_t i) {
+        dst[i] = libc_add_months(random[i], 1);
+    });
+    assert(dst[N / 2] == dtf::add_months(random[N / 2], 1));
+    const double months_ns = bench_ns(N, [&](std::size_t i) {
+        dst[i] = dtf::add_months(random[i], 1);
+    });
+    do_not_optimize(dst.data());
+    const double batch_random_ns = bench_ns(1, [&](std::size_t) {
+        dtf::add_months(dst.data(), random.data(), N, 1);
+    }) / N;
+    do_not_optimize(dst.data());
+    const double batch_sorted_ns = bench_ns(1, [&](std::size_t) {
+        dtf::add_months(dst.data(), sorted.data(), N, 1);
+    }) / N;
+    do_not_optimize(dst.data());
+
+    const double libc_weekday_ns = bench_ns(N, [&](std::size_t i) {
+        dst[i] = libc_next_weekday(random[i], 1);
+    });
+    assert(dst[N / 2] == dtf::next_weekday(random[N / 2], 1));
+    const double weekday_ns = bench_ns(N, [&](std::size_t i) {
+        dst[i] = dtf::next_weekday(random[i], 1);
+    });
+    do_not_optimize(dst.data());
+
+    std::cout << std::fixed << std::setprecision(2)
+        << "add_months, gmtime_r + timegm: " << std::setw(6) << libc_months_ns << " ns/ts\n"
+        << "add_months                   : " << std::setw(6) << months_ns << " ns/ts\n"
+        << "add_months, batch, random    : " << std::setw(6) << batch_random_ns << " ns/ts\n"
+        << "add_months, batch, sorted    : " << std::setw(6) << batch_sorted_ns << " ns/ts\n"
+        << "next_weekday, gmtime_r+timegm: " << std::setw(6) << libc_weekday_ns << " ns/ts\n"
+        << "next_weekday                 : " << std::setw(6) << weekday_ns << " ns/ts\n"
+    ;
+}
+
+/*************************************************************************************************/
+
+static void bench_packed() {
+    constexpr auto flags = dtf::yyyy_mm_dd|dtf::date_sep_dash|dtf::dt_sep_T|dtf::time_sep_colon|dtf::msecs|dtf::zone_Z;
+    const std::uint64_t base = dtf::timestamp();
+
+    // the random timestamps within a year, stored once in both forms
+    constexpr std::size_t N = 1 << 22;
+    std::vector<std::uint64_t> tss(N);
+    std::vector<dtf::packed_dt> packed(N);
+    std::uint64_t seed = 0x9E3779B97F4A7C15ull;
+    for ( std::size_t i = 0; i < N; ++i ) {
+        seed ^= seed << 13;
+        seed ^= seed >> 7;
+        seed ^= seed << 17;
+        tss[i] = base - seed % (365ull * 86400ull * 1000000000ull);
+        packed[i] = dtf::to_packed(tss[i]);
+    }
+
+    char buf[dtf::bufsize];
+    const double cached_ns = bench_ns(N, [&](std::size_t i) {
+        do_not_optimize(dtf::to_dt_chars(buf, tss[i], flags));
+        do_not_optimize(buf);
+    });
+    const double no_cache_ns = bench_ns(N, [&](std::size_t i) {
+        do_not_optimize(dtf::to_dt_chars(buf, tss[i], flags, dtf::no_cache));
+        do_not_optimize(buf);
+    });
+    const double packed_ns = bench_ns(N, [&](std::size_t i) {
+        do_not_optimize(dtf::to_dt_chars(buf, packed[i], flags));
+        do_not_optimize(buf);
+    });
+    const double to_packed_ns = bench_ns(N, [&](std::size_t i) {
+        do_not_optimize(dtf::to_packed(tss[i]));
+    });
+    const double from_packed_ns = bench_ns(N, [&](std::size_t i) {
+        do_not_optimize(dtf::from_packed(packed[i]));
+    });
+    const auto sort_start = std::chrono::steady_clock::now();
+    std::sort(packed.begin(), packed.end());
+    const std::chrono::duration<double, std::nano> sort_time = std::chrono::steady_clock::now() - sort_start;
+
+    std::cout << std::fixed << std::setprecision(2)
+        << "random, to_dt_chars()    : " << std::setw(7) << cached_ns << " ns/call\n"
+        << "random, dtf::no_cache    : " << std::setw(7) << no_cache_ns << " ns/call\n"
+        << "random, dtf::packed_dt   : " << std::setw(7) << packed_ns << " ns/call\n"
+        << "to_packed()              : " << std::setw(7) << to_packed_ns << " ns/call\n"
+        << "from_packed()            : " << std::setw(7) << from_packed_ns << " ns/call\n"
+        << "std::sort(), packed_dt   : " << std::setw(7) << sort_time.count() / N << " ns/item\n"
+    ;
+}
+
+/*************************************************************************************************/
+
+// the k-way merge of the sorted streams of the date-time strings, the key of the head line of
+// the stream is got by `key(&k, str)` once per line. returns the num of the lines merged.
+template<typename Key, typename KeyFunc, typename Less>
+static std::size_t merge_streams(const std::vector<std::vector<std::string>> &streams, KeyFunc key, Less less) {
+    struct head {
+        Key key;
+        std::size_t stream;
+        std::size_t line;
+    };
+    const auto greater = [&less](const head &l, const head &r) { return less(r.key, l.key); };
+    std::priority_queue<head, std::vector<head>, decltype(greater)> heap{greater};
+    for ( std::size_t i = 0; i < streams.size(); ++i ) {
+        head h{Key{}, i, 0};
+        key(&h.key, streams[i][0]);
+        heap.push(h);
+    }
+
+    std::size_t merged = 0;
+    while ( !heap.empty() ) {
+        head h = heap.top();
+        heap.pop();
+        do_not_optimize(streams[h.stream][h.line].data());
+        ++merged;
+        if ( ++h.line != streams[h.stream].size() ) {
+            key(&h.key, streams[h.stream][h.line]);
+            heap.push(h);
+        }
+    }
+
+    return merged;
+}
+
+static void bench_merge() {
+    constexpr auto flags = dtf::dd_mm_yyyy|dtf::date_sep_point|dtf::dt_sep_space|dtf::time_sep_colon|dtf::msecs;
+
+    // the logs of 8 sources, ~2 hours of every source
+    constexpr std::size_t K = 8;
+    constexpr std::size_t M = 1 << 18;
+    std::vector<std::vector<std::string>> streams(K);
+    std::uint64_t seed = 0x9E3779B97F4A7C15ull;
+    std::size_t bytes = 0;
+    for ( auto &stream: streams ) {
+        std::uint64_t ts = dtf::timestamp();
+        for ( std::size_t i = 0; i < M; ++i ) {
+            seed ^= seed << 13;
+            seed ^= seed >> 7;
+            seed ^= seed << 17;
+            ts += seed % 60000000ull;
+            stream.push_back(dtf::to_dt_str(ts, flags));
+            bytes += stream.back().size();
+        }
+    }
+
+    // the keys only
+    const std::vector<std::string> &lines = streams[0];
+    const double parse_ns = bench_ns(M, [&](std::size_t i) {
+        std::uint64_t ts;
+        do_not_optimize(dtf::from_dt_chars(&ts, lines[i].data(), lines[i].size(), flags));
+        do_not_optimize(ts);
+    });
+    const double key_ns = bench_ns(M, [&](std::size_t i) {
+        do_not_optimize(dtf::sort_key(lines[i].data(), lines[i].size(), flags));
+    });
+    const double key8_ns = bench_ns(M, [&](std::size_t i) {
+        char key[dtf::short_sort_key_size];
+        dtf::short_sort_key(key, lines[i].data(), lines[i].size(), flags);
+        do_not_optimize(key);
+    });
+    const double key16_ns = bench_ns(M, [&](std::size_t i) {
+        char key[dtf::sort_key_size];
+        dtf::sort_key(key, lines[i].data(), lines[i].size(), flags);
+        do_not_optimize(key);
+    });
+    std::cout << std::fixed << std::setprecision(2)
+        << "from_dt_chars()                : " << std::setw(7) << parse_ns << " ns/line\n"
+        << "sort_key(), dtf::packed_dt     : " << std::setw(7) << key_ns << " ns/line\n"
+        << "short_sort_key(), 8 bytes      : " << std::setw(7) << key8_ns << " ns/line\n"
+        << "sort_key(), 16 bytes           : " << std::setw(7) << key16_ns << " ns/line\n"
+    ;
+
+    using key16 = std::array<char, dtf::sort_key_size>;
+    const auto bench = [&streams](const char *name, std::size_t bytes, double (*run)(const std::vector<std::vector<std::string>> &)) {
+        const auto start = std::chrono::steady_clock::now();
+        const double merged = run(streams);
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        std::cout << std::fixed << std::setprecision(2)
+            << name << std::setw(7) << elapsed.count() * 1e9 / merged << " ns/line, "
+            << std::setw(7) << static_cast<double>(bytes) / elapsed.count() / (1 << 20) << " MiB/s\n"
+        ;
+    };
+    bench("merge, from_dt_chars()         : ", bytes, [](const std::vector<std::vector<std::string>> &s) {
+        return static_cast<double>(merge_streams<std::uint64_t>(s
+            ,[](std::uint64_t *k, const std::string &str) { dtf::from_dt_chars(k, str.data(), str.size(), flags); }
+            ,std::less<std::uint64_t>{}
+        ));
+    });
+    bench("merge, sort_key(), packed_dt   : ", bytes, [](const std::vector<std::vector<std::string>> &s) {
+        return static_cast<double>(merge_streams<dtf::packed_dt>(s
+            ,[](dtf::packed_dt *k, const std::string &str) { *k = dtf::sort_key(str.data(), str.size(), flags); }
+            ,std::less<dtf::packed_dt>{}
+        ));
+    });
+    bench("merge, sort_key(), memcmp()    : ", bytes, [](const std::vector<std::vector<std::string>> &s) {
+        return static_cast<double>(merge_streams<key16>(s
+            ,[](key16 *k, const std::string &str) { dtf::sort_key(k->data(), str.data(), str.size(), flags); }
+            ,[](const key16 &l, const key16 &r) { return std::memcmp(l.data(), r.data(), l.size()) < 0; }
+        ));
+    });
+}
+
+/*************************************************************************************************/
+
+// the usual encoder: the base is a run-time value, the digits are prepended to the string
+static std::string naive_sortable_id(std::uint64_t v, const char *alphabet, std::uint64_t base, std::size_t width) {
+    std::string res;
+    for ( ; width; --width ) {
+        res.insert(res.begin(), alphabet[v % base]);
+        v /= base;
+    }
+
+    return res;
+}
+
+static void bench_sortable_id() {
+    constexpr std::size_t N = 1 << 20;
+    std::vector<std::uint64_t> tss(N);
+    const std::uint64_t base = dtf::timestamp();
+    for ( std::size_t i = 0; i < N; ++i ) {
+        tss[i] = base + i * 1000003ull;
+    }
+    std::vector<char> ids(N * 13);
+
+    std::cout << std::fixed << std::setprecision(2);
+    static const struct {
+        const char *name;
+        dtf::sortable_id fmt;
+        const char *alphabet;
+        std::uint64_t base;
+    } fmts[] = {
+         {"base32", dtf::id_base32_64, "0123456789ABCDEFGHJKMNPQRSTVWXYZ", 32}
+        ,{"base36", dtf::id_base36_64, "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ", 36}
+    };
+    for ( const auto &it: fmts ) {
+        const double naive_ns = bench_ns(N, [&](std::size_t i) {
+            do_not_optimize(naive_sortable_id(tss[i], it.alphabet, it.base, 13));
+        });
+        char buf[dtf::bufsize];
+        const double dtf_ns = bench_ns(N, [&](std::size_t i) {
+            do_not_optimize(dtf::to_sortable_id_chars(buf, tss[i], it.fmt));
+            do_not_optimize(buf);
+        });
+        const auto start = std::chrono::steady_clock::now();
+        do_not_optimize(dtf::to_sortable_id_chars(ids.data(), tss.data(), N, it.fmt));
+        do_not_optimize(ids.data());
+        const std::chrono::duration<double, std::nano> batch = std::chrono::steady_clock::now() - start;
+        const double decode_ns = bench_ns(N, [&](std::size_t i) {
+            std::uint64_t v = 0;
+            do_not_optimize(dtf::from_sortable_id_chars(&v, ids.data() + i * 13, 13, it.fmt));
+            do_not_optimize(v);
+        });
+
+        std::cout
+            << it.name << ", naive encoder          : " << std::setw(6) << naive_ns << " ns/id\n"
+            << it.name << ", to_sortable_id_chars() : " << std::setw(6) << dtf_ns << " ns/id\n"
+            << it.name << ", batch                  : " << std::setw(6) << batch.count() / N << " ns/id\n"
+            << it.name << ", from_sortable_id_chars(): " << std::setw(5) << decode_ns << " ns/id\n"
+        ;
+    }
+}
+
+/*************************************************************************************************/
+
+static void bench_strict() {
+    const std::uint64_t base = dtf::timestamp();
+    const std::uint32_t formats[] = {
+         dtf::dd_mm_yyyy|dtf::date_sep_point|dtf::dt_sep_space|dtf::time_sep_colon|dtf::secs
+        ,dtf::yyyy_mm_dd|dtf::date_sep_empty|dtf::dt_sep_T|dtf::time_sep_empty|dtf::secs
+        ,dtf::yyyy_mm_dd|dtf::date_sep_dash|dtf::dt_sep_T|dtf::time_sep_colon|dtf::msecs|dtf::zone_Z
+        ,dtf::yyyy_mm_dd|dtf::date_sep_dash|dtf::dt_sep_space|dtf::time_sep_colon|dtf::usecs|dtf::zone_offset
+    };
+
+    // the valid date-times of the mixed formats
+    constexpr std::size_t N = 1 << 20;
+    std::vector<std::string> strs;
+    strs.reserve(N);
+    std::uint64_t seed = 0x9E3779B97F4A7C15ull;
+    for ( std::size_t i = 0; i < N; ++i ) {
+        seed ^= seed << 13;
+        seed ^= seed >> 7;
+        seed ^= seed << 17;
+        strs.push_back(dtf::to_dt_str(base - seed % (3650ull * 86400ull * 1000000000ull), formats[(i / 16) % 4]));
+    }
+
+    std::size_t ok = 0;
+    const double flags_ns = bench_ns(N, [&](std::size_t i) {
+        std::uint32_t flags;
+        ok += dtf::get_flags(&flags, strs[i].data(), strs[i].size()) == dtf::error::ok;
+        do_not_optimize(flags);
+    });
+    const double strict_ns = bench_ns(N, [&](std::size_t i) {
+        std::uint32_t flags;
+        ok += dtf::get_flags(&flags, strs[i].data(), strs[i].size(), dtf::strict) == dtf::error::ok;
+        do_not_optimize(flags);
+    });
+    // the way it was done before: the values are validated by the parsing
+    const double parse_ns = bench_ns(N, [&](std::size_t i) {
+        std::uint32_t flags;
+        std::uint64_t ts = 0;
+        ok += dtf::get_flags(&flags, strs[i].data(), strs[i].size()) == dtf::error::ok
+            && dtf::from_dt_chars(&ts, strs[i].data(), strs[i].size(), flags) == dtf::error::ok
+        ;
+        do_not_optimize(ts);
+    });
+    assert(ok == 3 * N);
+
+    std::cout << std::fixed << std::setprecision(2)
+        << "get_flags()                  : " << std::setw(6) << flags_ns << " ns/str\n"
+        << "get_flags(), dtf::strict     : " << std::setw(6) << strict_ns << " ns/str\n"
+        << "get_flags() + from_dt_chars(): " << std::setw(6) << parse_ns << " ns/str\n"
+    ;
+}
+
+/*************************************************************************************************/
+
+int main(int argc, char **argv) {
+    const struct {
+        const char *name;
+        void (*func)();
+    } benches[] = {
+         {"to_dt_chars", bench_to_dt_chars}
+        ,{"pattern", bench_pattern}
+        ,{"parse", bench_parse}
+        ,{"http_date", bench_http_date}
+        ,{"rfc3339", bench_rfc3339}
+        ,{"fields", bench_fields}
+        ,{"buckets", bench_buckets}
+        ,{"civil_cache", bench_civil_cache}
+        ,{"context", bench_context}
+        ,{"from_chars", bench_from_chars}
+        ,{"dispatch", bench_dispatch}
+        ,{"column", bench_column}
+        ,{"wall_mapper", bench_wall_mapper}
+        ,{"prefix", bench_prefix}
+        ,{"find_dt", bench_find_dt}
+        ,{"tables", bench_tables}
+        ,{"calendar", bench_calendar}
+        ,{"packed", bench_packed}
+        ,{"merge", bench_merge}
+        ,{"sortable_id", bench_sortable_id}
+        ,{"strict", bench_strict}
+    };
+
+    // run all the benchmarks when nothing is specified
+    bool found = argc == 1;
+    for ( const auto &it: benches ) {
+        bool selected = argc == 1;
+        for ( int i = 1; i < argc; ++i ) {
+            selected = selected || std::strcmp(argv[i], it.name) == 0;
+        }
+        if ( selected ) {
+            std::cout << "### " << it.name << std::endl;
+            it.func();
+            std::cout << std::endl;
+            found = true;
+        }
+    }
+
+    if ( !found ) {
+        std::cerr << "usage: " << argv[0] << " [";
+        for ( const auto &it: benches ) {
+            std::cerr << (&it == benches ? "" : "|") << it.name;
+        }
+        std::cerr << "]..." << std::endl;
+
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+/*************************************************************************************************/
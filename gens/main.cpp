@@ -31,6 +31,7 @@
 #include <fstream>
 #include <string>
 #include <vector>
+#include <algorithm>
 
 #include <cassert>
 #include <cstring>
@@ -46,8 +47,12 @@ bool is_wrong_specified(const char *str) {
     return std::strcmp(str, "wrong") == 0;
 }
 
+bool is_dispatch_specified(const char *str) {
+    return std::strcmp(str, "dispatch") == 0;
+}
+
 bool is_valid_flag(const char *str) {
-    return is_good_specified(str) || is_wrong_specified(str);
+    return is_good_specified(str) || is_wrong_specified(str) || is_dispatch_specified(str);
 }
 
 /*************************************************************************************************/
@@ -134,6 +139,15 @@ std::string print_time(std::uint32_t flags) {
     return res;
 }
 
+std::string print_zone(std::uint32_t flags) {
+    return (flags & dtf::zone_Z)
+        ? "Z"
+        : (flags & dtf::zone_offset)
+            ? "+00:00"
+            : ""
+    ;
+}
+
 char get_dt_sep_char(std::uint32_t flags) {
     constexpr auto dt_sep_mask =
           dtf::dt_sep_T
@@ -180,19 +194,21 @@ void emit_good_case(std::vector<std::string> &dst, std::size_t case_, std::uint3
     line += print_date(flags);
     line += get_dt_sep_char(flags);
     line += print_time(flags);
+    line += print_zone(flags);
     line += "\"\n)";
 
     dst.push_back(std::move(line));
 }
 
-void generate_good(std::vector<std::string> &dst) {
-    std::size_t case_ = 0u;
-
+// calls `cb` for every valid flags combination
+template<typename F>
+void for_each_good_flags(F cb) {
     const std::uint32_t date_fmts[] = {dtf::yyyy_mm_dd, dtf::dd_mm_yyyy};
     const std::uint32_t date_seps[] = {dtf::date_sep_dash, dtf::date_sep_point, dtf::date_sep_empty};
     const std::uint32_t dt_seps[]   = {dtf::dt_sep_T, dtf::dt_sep_t, dtf::dt_sep_space, dtf::dt_sep_underscore, dtf::dt_sep_slash, dtf::dt_sep_dash};
     const std::uint32_t time_seps[] = {dtf::time_sep_colon, dtf::time_sep_point, dtf::time_sep_empty};
     const std::uint32_t time_precs[]= {dtf::secs, dtf::msecs, dtf::usecs, dtf::nsecs};
+    const std::uint32_t zones[]     = {0u, dtf::zone_Z, dtf::zone_offset};
 
     for ( const auto date_fmt: date_fmts ) {
         for ( const auto date_sep: date_seps ) {
@@ -205,16 +221,18 @@ void generate_good(std::vector<std::string> &dst) {
                 ;
                 for ( const auto time_sep: time_seps ) {
                     for ( const auto time_prec: time_precs ) {
-                        std::uint32_t flags = date_fmt | date_sep | forced_dt_sep | time_sep | time_prec;
-                        emit_good_case(dst, case_++, flags);
+                        for ( const auto zone: zones ) {
+                            cb(date_fmt | date_sep | forced_dt_sep | time_sep | time_prec | zone);
+                        }
                     }
                 }
             } else {
                 for ( const auto dt_sep: dt_seps ) {
                     for ( const auto time_sep: time_seps ) {
                         for ( const auto time_prec: time_precs ) {
-                            std::uint32_t flags = date_fmt | date_sep | dt_sep | time_sep | time_prec;
-                            emit_good_case(dst, case_++, flags);
+                            for ( const auto zone: zones ) {
+                                cb(date_fmt | date_sep | dt_sep | time_sep | time_prec | zone);
+                            }
                         }
                     }
                 }
@@ -223,6 +241,13 @@ void generate_good(std::vector<std::string> &dst) {
     }
 }
 
+void generate_good(std::vector<std::string> &dst) {
+    std::size_t case_ = 0u;
+    for_each_good_flags([&dst, &case_](std::uint32_t flags) {
+        emit_good_case(dst, case_++, flags);
+    });
+}
+
 /*************************************************************************************************/
 
 const char *error_name(dtf::error e) {
@@ -242,6 +267,15 @@ const char *error_name(dtf::error e) {
         case dtf::error::wrong_ms_digits:             return "dtf::error::wrong_ms_digits";
         case dtf::error::wrong_us_digits:             return "dtf::error::wrong_us_digits";
         case dtf::error::wrong_ns_digits:             return "dtf::error::wrong_ns_digits";
+        case dtf::error::wrong_pattern_spec:          return "dtf::error::wrong_pattern_spec";
+        case dtf::error::pattern_too_long:            return "dtf::error::pattern_too_long";
+        case dtf::error::pattern_mismatch:            return "dtf::error::pattern_mismatch";
+        case dtf::error::wrong_pattern_value:         return "dtf::error::wrong_pattern_value";
+        case dtf::error::wrong_zone_offset:           return "dtf::error::wrong_zone_offset";
+        case dtf::error::wrong_number:                return "dtf::error::wrong_number";
+        case dtf::error::number_out_of_range:         return "dtf::error::number_out_of_range";
+        case dtf::error::dt_mismatch:                 return "dtf::error::dt_mismatch";
+        case dtf::error::wrong_dt_value:              return "dtf::error::wrong_dt_value";
     }
     return "dtf::error::ok";
 }
@@ -298,6 +332,7 @@ void generate_wrong(std::vector<std::string> &dst) {
     emit_wrong_case(dst, case_++, dtf::error::wrong_yyyy_mm_dd_sep, "201X-01-08T16:50:23");
     emit_wrong_case(dst, case_++, dtf::error::wrong_yyyy_mm_dd_sep, "2019-0X-08T16:50:23");
     emit_wrong_case(dst, case_++, dtf::error::wrong_yyyy_mm_dd_sep, "2019-01-X8T16:50:23");
+    emit_wrong_case(dst, case_++, dtf::error::wrong_yyyy_mm_dd_sep, "2019X01X08T16:50:23");
 
     // wrong_time_sep: time with separator but invalid digits
     emit_wrong_case(dst, case_++, dtf::error::wrong_time_sep, "2019-01-08T1X:50:23");
@@ -333,6 +368,174 @@ void generate_wrong(std::vector<std::string> &dst) {
     emit_wrong_case(dst, case_++, dtf::error::wrong_ns_digits, "2019-01-08T16:50:23.X06057057");
     emit_wrong_case(dst, case_++, dtf::error::wrong_ns_digits, "2019-01-08T16:50:23.006057X57");
     emit_wrong_case(dst, case_++, dtf::error::wrong_ns_digits, "2019-01-08T16:50:23.00605705X");
+
+    // wrong_zone_offset: `+hh:mm`/`-hh:mm` suffix with non-digit
+    emit_wrong_case(dst, case_++, dtf::error::wrong_zone_offset, "2019-01-08T16:50:23+0X:00");
+    emit_wrong_case(dst, case_++, dtf::error::wrong_zone_offset, "2019-01-08T16:50:23-05:X0");
+    emit_wrong_case(dst, case_++, dtf::error::wrong_zone_offset, "20190108T165023.006057057+05:3X");
+
+    // the zone suffix is valid, but the rest is wrong
+    emit_wrong_case(dst, case_++, dtf::error::too_short, "20190108T16502Z");
+    emit_wrong_case(dst, case_++, dtf::error::too_long, "2019-01-08T16:50:23.0060570570Z");
+    emit_wrong_case(dst, case_++, dtf::error::too_long, "2019-01-08T16:50:23.0060570570+05:30");
+    emit_wrong_case(dst, case_++, dtf::error::wrong_dt_end_char, "2019-01-08T16:50:23XZ");
+    emit_wrong_case(dst, case_++, dtf::error::wrong_dt_end_char, "2019-01-08T16:50:23X+05:30");
+    emit_wrong_case(dst, case_++, dtf::error::wrong_dt_end_char, "2019-01-08T16:50:23+0530");
+    emit_wrong_case(dst, case_++, dtf::error::wrong_num_of_secs_fractions, "2019-01-08T16:50:23.00Z");
+    emit_wrong_case(dst, case_++, dtf::error::wrong_ms_digits, "2019-01-08T16:50:23.00X-01:00");
+}
+
+/*************************************************************************************************/
+
+// the perfect hash of the valid flags combinations, "hash and displace":
+//   bucket = (flags * bucket_mul) >> (32 - bucket_bits)
+//   slot   = ((flags * slot_mul) >> (32 - slot_bits)) ^ disps[bucket]
+// the multipliers are searched until the displacements are found for all the buckets.
+struct dispatch_hash {
+    std::uint32_t bucket_mul;
+    std::uint32_t slot_mul;
+    std::uint32_t bucket_bits;
+    std::uint32_t slot_bits;
+    std::vector<std::uint16_t> disps;
+    std::vector<std::uint32_t> slots; // the flags by slot, zero for the empty ones
+};
+
+std::uint32_t dispatch_bucket(const dispatch_hash &h, std::uint32_t flags) {
+    return (flags * h.bucket_mul) >> (32u - h.bucket_bits);
+}
+
+std::uint32_t dispatch_slot(const dispatch_hash &h, std::uint32_t flags) {
+    return (flags * h.slot_mul) >> (32u - h.slot_bits);
+}
+
+bool try_dispatch_hash(dispatch_hash &h, const std::vector<std::uint32_t> &keys) {
+    const std::uint32_t num_buckets = 1u << h.bucket_bits;
+    const std::uint32_t num_slots = 1u << h.slot_bits;
+
+    std::vector<std::vector<std::uint32_t>> buckets(num_buckets);
+    for ( const auto key: keys ) {
+        buckets[dispatch_bucket(h, key)].push_back(key);
+    }
+
+    // the largest buckets first
+    std::vector<std::uint32_t> order(num_buckets);
+    for ( std::uint32_t i = 0; i < num_buckets; ++i ) {
+        order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(), [&buckets](std::uint32_t l, std::uint32_t r) {
+        return buckets[l].size() > buckets[r].size();
+    });
+
+    h.disps.assign(num_buckets, 0);
+    h.slots.assign(num_slots, 0);
+    for ( const auto b: order ) {
+        const auto &bucket = buckets[b];
+        if ( bucket.empty() ) {
+            break;
+        }
+
+        bool placed = false;
+        for ( std::uint32_t disp = 0; disp < num_slots && !placed; ++disp ) {
+            std::vector<std::uint32_t> taken;
+            placed = true;
+            for ( const auto key: bucket ) {
+                const std::uint32_t slot = dispatch_slot(h, key) ^ disp;
+                if ( h.slots[slot] != 0 || std::find(taken.begin(), taken.end(), slot) != taken.end() ) {
+                    placed = false;
+                    break;
+                }
+                taken.push_back(slot);
+            }
+            if ( placed ) {
+                for ( std::size_t i = 0; i < bucket.size(); ++i ) {
+                    h.slots[taken[i]] = bucket[i];
+                }
+                h.disps[b] = static_cast<std::uint16_t>(disp);
+            }
+        }
+        if ( !placed ) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void generate_dispatch(std::vector<std::string> &dst) {
+    std::vector<std::uint32_t> keys;
+    for_each_good_flags([&keys](std::uint32_t flags) {
+        keys.push_back(flags);
+    });
+
+    dispatch_hash h{};
+    h.bucket_bits = 9;  // ~2 keys per bucket
+    h.slot_bits = 10;   // the min power of two for all the keys
+    assert(keys.size() <= (1u << h.slot_bits));
+
+    // the deterministic search, so the output is the same for every run
+    std::uint64_t seed = 0x9E3779B97F4A7C15ull;
+    const auto next_odd = [&seed]() {
+        seed ^= seed << 13;
+        seed ^= seed >> 7;
+        seed ^= seed << 17;
+        return static_cast<std::uint32_t>(seed >> 32) | 1u;
+    };
+    do {
+        h.bucket_mul = next_odd();
+        h.slot_mul = next_odd();
+    } while ( !try_dispatch_hash(h, keys) );
+
+    char buf[256];
+    dst.push_back("// generated by `gens dispatch`, DO NOT EDIT!");
+    dst.push_back("// " + std::to_string(keys.size()) + " flags combinations");
+    dst.push_back("");
+    dst.push_back("enum: std::uint32_t {");
+    std::snprintf(buf, sizeof(buf), "     dispatch_bucket_mul = 0x%08xu", h.bucket_mul);
+    dst.push_back(buf);
+    std::snprintf(buf, sizeof(buf), "    ,dispatch_slot_mul = 0x%08xu", h.slot_mul);
+    dst.push_back(buf);
+    dst.push_back("    ,dispatch_bucket_bits = " + std::to_string(h.bucket_bits));
+    dst.push_back("    ,dispatch_slot_bits = " + std::to_string(h.slot_bits));
+    dst.push_back("};");
+    dst.push_back("");
+
+    // the static members of the class template to be defined once for all the translation units
+    const std::string disps_size = std::to_string(h.disps.size());
+    const std::string table_size = std::to_string(h.slots.size());
+    dst.push_back("template<typename = void>");
+    dst.push_back("struct dispatch_luts {");
+    dst.push_back("    static const std::uint16_t disps[" + disps_size + "];");
+    dst.push_back("    static const dispatch_entry table[" + table_size + "];");
+    dst.push_back("};");
+    dst.push_back("");
+
+    dst.push_back("template<typename T> const std::uint16_t dispatch_luts<T>::disps[" + disps_size + "] = {");
+    for ( std::size_t i = 0; i < h.disps.size(); i += 16 ) {
+        std::string line = "    ";
+        for ( std::size_t j = i; j < i + 16 && j < h.disps.size(); ++j ) {
+            std::snprintf(buf, sizeof(buf), "%s%u", (j == 0 ? " " : ","), static_cast<unsigned>(h.disps[j]));
+            line += buf;
+        }
+        dst.push_back(line);
+    }
+    dst.push_back("};");
+    dst.push_back("");
+
+    dst.push_back("template<typename T> const dispatch_entry dispatch_luts<T>::table[" + table_size + "] = {");
+    for ( std::size_t i = 0; i < h.slots.size(); ++i ) {
+        const std::uint32_t flags = h.slots[i];
+        const char *comma = i == 0 ? " " : ",";
+        if ( flags == 0 ) {
+            std::snprintf(buf, sizeof(buf), "    %s{0x00000000u, nullptr}", comma);
+            dst.push_back(buf);
+        } else {
+            std::ostringstream os;
+            dtf::dump_flags(os, flags);
+            std::snprintf(buf, sizeof(buf), "    %s{0x%08xu, &to_dt_chars_fixed<0x%08xu>} // ", comma, flags, flags);
+            dst.push_back(buf + os.str());
+        }
+    }
+    dst.push_back("};");
 }
 
 /*************************************************************************************************/
@@ -353,19 +556,22 @@ int main(int argc, char *const *argv) {
 
         std::cerr
             << "wrong command line!" << std::endl
-            << exename << " <good|wrong>" << std::endl
+            << exename << " <good|wrong|dispatch>" << std::endl
         ;
 
         return EXIT_FAILURE;
     }
 
     const bool is_good = is_good_specified(argv[1]);
-    const char *fname = is_good ? "good.inc" : "wrong.inc";
+    const bool is_dispatch = is_dispatch_specified(argv[1]);
+    const char *fname = is_good ? "good.inc" : is_dispatch ? "dispatch.inc" : "wrong.inc";
     std::cout << "generating \"" << fname << "\"..." << std::endl;
 
     std::vector<std::string> strings;
     if ( is_good ) {
         generate_good(strings);
+    } else if ( is_dispatch ) {
+        generate_dispatch(strings);
     } else {
         generate_wrong(strings);
     }
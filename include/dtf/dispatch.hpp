@@ -0,0 +1,83 @@
+
+// MIT License
+//
+// Copyright (c) 2019-2025 niXman (github dot nixman at pm dot me)
+// All rights reserved.
+//
+// This file is part of DTF(https://github.com/niXman/dtf) project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef __dtf__dispatch_hpp
+#define __dtf__dispatch_hpp
+
+#include "dtf.hpp"
+
+namespace dtf {
+
+/*************************************************************************************************/
+
+// the formatter specialized for one flags combination, see `dtf::to_dt_chars_fixed()`
+using formatter = std::size_t (*)(char *buf, std::uint64_t ts);
+
+// returns the specialized formatter for `flags`, or `nullptr` when the combination is not valid.
+// can be called once for the hot loop.
+formatter get_formatter(std::uint32_t flags);
+
+// the same as `to_dt_chars(buf, ts, flags)` through the specialized formatter
+std::size_t to_dt_chars_dispatch(char *buf, std::uint64_t ts, std::uint32_t flags);
+
+/*************************************************************************************************/
+
+} // ns dtf
+
+/*************************************************************************************************/
+/*************************************************************************************************/
+/*************************************************************************************************/
+
+namespace dtf {
+
+struct dispatch_entry {
+    std::uint32_t flags;
+    formatter func;
+};
+
+// the perfect hash of all the valid flags combinations, generated by `gens dispatch`
+#include "dispatch.inc"
+
+inline formatter get_formatter(std::uint32_t flags) {
+    const std::uint32_t bucket = (flags * dispatch_bucket_mul) >> (32u - dispatch_bucket_bits);
+    const std::uint32_t slot = ((flags * dispatch_slot_mul) >> (32u - dispatch_slot_bits)) ^ dispatch_luts<>::disps[bucket];
+    const dispatch_entry &entry = dispatch_luts<>::table[slot];
+
+    return entry.flags == flags ? entry.func : nullptr;
+}
+
+inline std::size_t to_dt_chars_dispatch(char *buf, std::uint64_t ts, std::uint32_t flags) {
+    const formatter func = get_formatter(flags);
+    assert(func && "the flags combination is not valid!");
+
+    return func(buf, ts);
+}
+
+/*************************************************************************************************/
+
+} // ns dtf
+
+#endif // __dtf__dispatch_hpp
@@ -30,12 +30,62 @@
 #include <string>
 #include <ostream>
 #include <chrono>
+#include <atomic>
+#include <algorithm>
+#include <type_traits>
+#include <limits>
+#if __cplusplus >= 201703L
+#   include <string_view>
+#endif // __cplusplus >= 201703L
 
 #include <cstdint>
+#include <cstdlib>
 #include <ctime>
 #include <cassert>
 #include <cstring>
 
+// the number of seconds kept in the per-thread conversion cache.
+// can be increased when one thread formats the timestamps of several interleaved sources.
+#ifndef DTF_CIVIL_CACHE_SIZE
+#   define DTF_CIVIL_CACHE_SIZE 4
+#endif // DTF_CIVIL_CACHE_SIZE
+
+// the num of days before and after the day of the first use which dates are rendered
+// in advance by the precomputed tables mode, see `dtf::tables`.
+#ifndef DTF_TABLES_DAYS
+#   define DTF_TABLES_DAYS 1024
+#endif // DTF_TABLES_DAYS
+
+// when defined, the per-thread counters of the conversion cache are kept, see `dtf::cache_stats`.
+// costs nothing when not defined. as `DTF_CIVIL_CACHE_SIZE`, it must be the same in all the
+// translation units of the program: it changes the definitions of the inline functions.
+#ifdef DTF_ENABLE_CACHE_STATS
+#   include <mutex>
+#   include <vector>
+#endif // DTF_ENABLE_CACHE_STATS
+
+// when defined, the hot functions (`to_dt_chars()`, `get_flags()`, `from_dt_chars()`...) are
+// declared only, they are compiled once into the `dtf` library, see `lib/`.
+// the `dtf` CMake target defines it for its users.
+// #define DTF_LIBRARY
+
+// `find_dt()` scans 16 bytes at a time using SSE2, the baseline of x86-64, and 32/64 bytes using
+// AVX2/AVX-512 on x86-64 when the CPU supports them, the kernel is selected at run time.
+// when defined, the scalar code is used only.
+#if !defined(DTF_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#   define __DTF_SSE2
+#   if (defined(__GNUC__) && defined(__x86_64__)) || (defined(_MSC_VER) && defined(_M_X64))
+        // the AVX kernels are compiled for their targets only, the binary runs on any x86-64
+#       define __DTF_AVX
+#       include <immintrin.h>
+#   else
+#       include <emmintrin.h>
+#   endif // __DTF_AVX
+#   ifdef _MSC_VER
+#       include <intrin.h>
+#   endif // _MSC_VER
+#endif // DTF_NO_SIMD
+
 namespace dtf {
 
 /*************************************************************************************************/
@@ -69,6 +119,8 @@ enum flags: std::uint32_t {
     ,msecs             = 1u << 15u // milliseconds resolution
     ,usecs             = 1u << 16u // microseconds resolution
     ,nsecs             = 1u << 17u // nanoseconds resolution
+    ,zone_Z            = 1u << 18u // 2018-12-11T13:58:59Z (RFC 3339, UTC)
+    ,zone_offset       = 1u << 19u // 2018-12-11T13:58:59+05:30 (RFC 3339, numeric offset)
 };
 
 // NOTE:
@@ -90,11 +142,11 @@ enum flags: std::uint32_t {
 // the required size of buffer for the max length of string representation:
 // yyyy(4) + `date sep`(1) + mm(2) + `date sep`(1) + dd(2) + `date-time sep`(1)
 // + hh(2) + `time sep`(1) + mm(2) + `time sep`(1) + ss(2) + `period char when advanced resolution specified`(1)
-// + `nanoseconds counter`(9) = 29
+// + `nanoseconds counter`(9) + `zone offset`(6) = 35
 enum {
-     bufsize = 32
+     bufsize = 40
     ,bufsize_min = 15
-    ,bufsize_max = 29
+    ,bufsize_max = 35
 };
 
 constexpr auto default_flags =
@@ -119,10 +171,231 @@ std::string to_str(std::uint32_t flags = default_flags, int offset_in_hours = 0)
 // `buf` - the destination buffer with at least `dtf::bufsize` bytes.
 std::size_t to_dt_chars(char *buf, std::uint64_t ts, std::uint32_t flags = default_flags);
 
+// the same for the local time of `ts` with the offset from UTC,
+// which is written as `+hh:mm`/`-hh:mm` when `dtf::zone_offset` is specified.
+std::size_t to_dt_chars(char *buf, std::uint64_t ts, std::uint32_t flags, int offset_in_minutes);
+
 std::string to_dt_str(std::uint64_t ts, std::uint32_t flags = default_flags);
 
+std::string to_dt_str(std::uint64_t ts, std::uint32_t flags, int offset_in_minutes);
+
+// the caller-owned state of the conversions, e.g. one per coroutine or per hot loop.
+// the overloads taking it don't touch the `thread_local` state.
+struct context;
+
+// the tag for the overloads which don't use any cache at all
+struct no_cache_t {};
+constexpr no_cache_t no_cache{};
+
+std::size_t to_dt_chars(char *buf, std::uint64_t ts, std::uint32_t flags, context &ctx);
+
+std::size_t to_dt_chars(char *buf, std::uint64_t ts, std::uint32_t flags, int offset_in_minutes, context &ctx);
+
+std::size_t to_dt_chars(char *buf, std::uint64_t ts, std::uint32_t flags, no_cache_t);
+
+std::size_t to_dt_chars(char *buf, std::uint64_t ts, std::uint32_t flags, int offset_in_minutes, no_cache_t);
+
+// the tag for the overloads using the precomputed tables: the time of day strings for all the
+// seconds of the day (675 KiB per time separator style) and the dates of `DTF_TABLES_DAYS` days
+// around the first use (per date style). the tables are built on the first use of the style,
+// then the formatting is two table loads plus the fraction. the dates outside of the window
+// are converted as usual.
+struct tables_t {};
+constexpr tables_t tables{};
+
+std::size_t to_dt_chars(char *buf, std::uint64_t ts, std::uint32_t flags, tables_t);
+
+std::size_t to_dt_chars(char *buf, std::uint64_t ts, std::uint32_t flags, int offset_in_minutes, tables_t);
+
+// the memory used by the tables built so far, bytes
+std::size_t tables_memory();
+
+// the same as `to_dt_chars(buf, ts, F)` specialized for the flags known at compile time.
+// see `dtf/dispatch.hpp` for the flags known at run time only.
+template<std::uint32_t F>
+std::size_t to_dt_chars_fixed(char *buf, std::uint64_t ts);
+
 std::string dt_str(std::uint32_t flags = default_flags, int offset_in_hours = 0);
 
+// the length of the date-time string formatted with `flags`
+std::size_t dt_chars_size(std::uint32_t flags = default_flags);
+
+// formats `n` timestamps into the column of strings in Apache Arrow layout:
+// the row `i` is placed into `data[offsets[i], offsets[i + 1])`.
+// `offsets` - `n + 1` items, the `offsets[0]` is the offset of the first row and must be set
+//             by the caller (zero for the new column, the end of the column to append to).
+// `data` - the column buffer with at least `offsets[0] + n * dt_chars_size(flags)` bytes.
+// returns the num of chars placed.
+std::size_t to_dt_column(char *data, std::int32_t *offsets, const std::uint64_t *ts, std::size_t n
+    ,std::uint32_t flags = default_flags);
+
+std::size_t to_dt_column(char *data, std::int64_t *offsets, const std::uint64_t *ts, std::size_t n
+    ,std::uint32_t flags = default_flags);
+
+/*************************************************************************************************/
+
+// broken-down representation of timestamp, the replacement for `struct tm`
+struct fields {
+    std::uint32_t year;
+    std::uint32_t month; // [1-12]
+    std::uint32_t day;   // [1-31]
+    std::uint32_t hours; // [0-23]
+    std::uint32_t mins;  // [0-59]
+    std::uint32_t secs;  // [0-59]
+    std::uint32_t nsecs; // [0-999999999]
+    std::uint32_t wday;  // [0-6], 0 = Sunday
+    std::uint32_t yday;  // [0-365]
+};
+
+// the replacement for `gmtime_r()`
+fields to_fields(std::uint64_t ts);
+
+fields to_fields(std::uint64_t ts, context &ctx);
+
+fields to_fields(std::uint64_t ts, no_cache_t);
+
+// the replacement for `timegm()`.
+// `wday` and `yday` are ignored, the rest must be valid (unlike `timegm()`, they are not normalized).
+std::uint64_t from_fields(const fields &f);
+
+/*************************************************************************************************/
+
+// the packed representation of timestamp: the fields as BCD digits, from the most significant
+// nibble: yyyy mm dd hh mm ss cc, where `cc` - the hundredths of the second.
+// the packed values are ordered as the timestamps (truncated to 1/100 s) are, and the formatting
+// is the nibbles to ASCII only, without the calendar calculations and the divisions.
+// useful when the timestamp is stored once and formatted many times.
+struct packed_dt {
+    std::uint64_t value;
+
+    bool operator==(const packed_dt &r) const { return value == r.value; }
+    bool operator!=(const packed_dt &r) const { return value != r.value; }
+    bool operator< (const packed_dt &r) const { return value <  r.value; }
+    bool operator<=(const packed_dt &r) const { return value <= r.value; }
+    bool operator> (const packed_dt &r) const { return value >  r.value; }
+    bool operator>=(const packed_dt &r) const { return value >= r.value; }
+};
+
+// the fraction is truncated to 1/100 s
+packed_dt to_packed(std::uint64_t ts);
+
+std::uint64_t from_packed(packed_dt pdt);
+
+// the same as `to_dt_chars(buf, from_packed(pdt), flags)`: the `msecs`/`usecs`/`nsecs` fractions
+// are padded with zeros, `zone_offset` is always "+00:00".
+std::size_t to_dt_chars(char *buf, packed_dt pdt, std::uint32_t flags = default_flags);
+
+// the normalized key of the date-time string of any layout, the date-time string MUST be valid
+// for `flags` (e.g. detected by `get_flags()`). the fields are rearranged by the byte moves only,
+// so the keys of `dd_mm_yyyy` strings are ordered as the date-times are.
+// the zone designator is not the part of the key: the keys of the different offsets are not comparable.
+// the fraction is truncated to 1/100 s, the key is the same as `to_packed()` of the timestamp.
+// the key is the native-endian integer: it's ordered as the integer, not by `memcmp()`.
+packed_dt sort_key(const char *buf, std::size_t len, std::uint32_t flags);
+
+enum {
+     sort_key_size = 16
+    ,short_sort_key_size = 8
+};
+
+// the full precision key of `sort_key_size` bytes for `memcmp()` and radix sort: the BCD digits
+// yyyy mm dd hh mm ss fffffffff, big-endian, zero padded. the first 8 bytes are the big-endian
+// `sort_key(buf, len, flags).value`.
+void sort_key(char *key, const char *buf, std::size_t len, std::uint32_t flags);
+
+// the key of `short_sort_key_size` bytes for `memcmp()`: the big-endian `sort_key(buf, len, flags).value`.
+void short_sort_key(char *key, const char *buf, std::size_t len, std::uint32_t flags);
+
+/*************************************************************************************************/
+
+// the units of time buckets
+enum unit: std::uint32_t {
+     unit_second
+    ,unit_minute
+    ,unit_hour
+    ,unit_day
+    ,unit_week  // ISO 8601 week, starts on Monday
+    ,unit_month
+    ,unit_year
+};
+
+// truncates `ts` to the beginning of the bucket of `u` containing it.
+// for `unit_week` the `ts` MUST NOT be earlier than 1970-01-05 (the first Monday).
+std::uint64_t floor_to(unit u, std::uint64_t ts);
+
+// rounds `ts` up to the beginning of the next bucket of `u`, unless it's already aligned.
+std::uint64_t ceil_to(unit u, std::uint64_t ts);
+
+// the same for the `n` timestamps of `src`. `dst` and `src` may be the same array.
+void floor_to(unit u, std::uint64_t *dst, const std::uint64_t *src, std::size_t n);
+
+void ceil_to(unit u, std::uint64_t *dst, const std::uint64_t *src, std::size_t n);
+
+/*************************************************************************************************/
+
+// the calendar arithmetic, the time of day is kept.
+// the day is clamped to the end of the month: 2019-01-31 + 1 month = 2019-02-28.
+// `months`/`years` may be negative, the result MUST NOT be earlier than the epoch.
+std::uint64_t add_months(std::uint64_t ts, std::int32_t months);
+
+// 2020-02-29 + 1 year = 2021-02-28
+std::uint64_t add_years(std::uint64_t ts, std::int32_t years);
+
+// `month` - [1-12]
+std::uint32_t days_in_month(std::uint32_t year, std::uint32_t month);
+
+// the num of days in the month of `ts`
+std::uint32_t days_in_month(std::uint64_t ts);
+
+// the nearest day of the week `wday` ([0-6], 0 = Sunday) after the day of `ts`,
+// one week later when `ts` is on that day already. the time of day is kept.
+std::uint64_t next_weekday(std::uint64_t ts, std::uint32_t wday);
+
+// the same for the `n` timestamps of `src`. `dst` and `src` may be the same array.
+void add_months(std::uint64_t *dst, const std::uint64_t *src, std::size_t n, std::int32_t months);
+
+void add_years(std::uint64_t *dst, const std::uint64_t *src, std::size_t n, std::int32_t years);
+
+void next_weekday(std::uint64_t *dst, const std::uint64_t *src, std::size_t n, std::uint32_t wday);
+
+/*************************************************************************************************/
+
+#ifdef DTF_ENABLE_CACHE_STATS
+
+enum {
+    cache_stats_flag_sets = 16
+};
+
+// the counters of the per-thread conversion cache
+struct cache_stats {
+    std::uint64_t hits;
+    std::uint64_t misses;
+    std::uint64_t new_days; // the misses which required the full date conversion
+
+    // the formatting calls using the per-thread cache per flag set: `to_dt_chars()`,
+    // `to_dt_chars_fixed()`, `to_dt_chars_dispatch()`, `to_dt_column()`. the other users of the
+    // cache (`to_fields()`, `pattern`...) are counted by `hits`/`misses` only.
+    struct flag_set_calls {
+        std::uint32_t flags;
+        std::uint64_t calls;
+    } flag_sets[cache_stats_flag_sets];
+    std::uint32_t num_flag_sets;
+    std::uint64_t other_flag_sets_calls; // the calls of the flag sets which didn't fit into `flag_sets`
+};
+
+// the counters of the calling thread
+cache_stats get_thread_cache_stats();
+
+// the counters aggregated across all the threads, including the finished ones
+cache_stats get_cache_stats();
+
+// adds `src` to `dst`
+void merge_cache_stats(cache_stats *dst, const cache_stats &src);
+
+std::ostream& dump_cache_stats(std::ostream &os, const cache_stats &stats);
+
+#endif // DTF_ENABLE_CACHE_STATS
+
 /*************************************************************************************************/
 
 enum error: std::uint32_t {
@@ -141,18 +414,316 @@ enum error: std::uint32_t {
     ,wrong_ms_digits
     ,wrong_us_digits
     ,wrong_ns_digits
+    ,wrong_pattern_spec // unknown or malformed conversion specifier in `dtf::pattern`
+    ,pattern_too_long   // too many ops or literal chars in `dtf::pattern`
+    ,pattern_mismatch   // the string does not match `dtf::pattern`
+    ,wrong_pattern_value // the field parsed by `dtf::pattern` is out of range
+    ,wrong_zone_offset  // the zone offset suffix is not `+hh:mm`/`-hh:mm`
+    ,wrong_number       // the empty string or not a digit in the number
+    ,number_out_of_range // the number doesn't fit into the nanoseconds timestamp
+    ,dt_mismatch        // the date-time string doesn't match the flags
+    ,wrong_dt_value     // the field of the date-time string is out of range
+};
+
+// parses the number formatted by `to_chars()` and scales it back to nanoseconds
+// according to `secs`/`msecs`/`usecs`/`nsecs` of `flags`.
+error from_chars(std::uint64_t *ts, const char *buf, std::size_t len, std::uint32_t flags = default_flags);
+
+error from_chars(std::uint64_t *ts, const std::string &str, std::uint32_t flags = default_flags);
+
+// the same for `n` numbers at once.
+// returns the num of the parsed numbers, which is less than `n` when `bufs[ret]` is invalid.
+std::size_t from_chars(std::uint64_t *ts, const char *const *bufs, const std::size_t *lens, std::size_t n
+    ,std::uint32_t flags = default_flags);
+
+// the fixed width encodings of the number (e.g. the timestamp) into the strings which are ordered
+// lexicographically as the numbers are: the time-ordered IDs, the keys of the key-value stores...
+enum sortable_id: std::uint32_t {
+     id_base32_48 // 10 chars, Crockford's base32 as ULID, the number MUST be less than 2^48 (e.g. the milliseconds)
+    ,id_base32_64 // 13 chars, Crockford's base32
+    ,id_base36_48 // 10 chars, [0-9A-Z], the number MUST be less than 2^48
+    ,id_base36_64 // 13 chars, [0-9A-Z]
 };
 
+// the length of the ID of `fmt`
+std::size_t sortable_id_size(sortable_id fmt);
+
+// returns the num of chars placed.
+std::size_t to_sortable_id_chars(char *buf, std::uint64_t v, sortable_id fmt = id_base32_64);
+
+// the same for `n` numbers, the IDs are placed one after another without the separators.
+// `buf` - at least `n * sortable_id_size(fmt)` bytes.
+std::size_t to_sortable_id_chars(char *buf, const std::uint64_t *v, std::size_t n, sortable_id fmt = id_base32_64);
+
+// the lowercase letters are accepted too, and Crockford's aliases for base32: `I`, `L` as 1, `O` as 0.
+error from_sortable_id_chars(std::uint64_t *v, const char *buf, std::size_t len, sortable_id fmt = id_base32_64);
+
 // gets the respective flags using given date-time string (DTF format only!)
+// nothing is read past `n`, so the string may be the not terminated slice of the bigger buffer.
 error get_flags(std::uint32_t *flags, const char *buf, std::size_t n);
 
+// the same for the date-time at the beginning of `buf` followed by anything (the log line, for example).
+// `consumed` - the length of the longest date-time, the malformed fraction or zone is not consumed.
+error get_flags_prefix(std::uint32_t *flags, std::size_t *consumed, const char *buf, std::size_t n);
+
+// the tag for the overloads which check the values of the fields too, `get_flags()` checks the
+// chars only and accepts `2019-13-45T25:61:61`: the month is [01-12], the day is in the month
+// (including the leap years), the hours are [00-23], the mins are [00-59], the secs are [00-59]
+// or [00-60] for `strict_leap_second`, the zone offset is [00-23]:[00-59].
+// the wrong values are reported by `error::wrong_dt_value`.
+struct strict_t {
+    bool leap_second;
+};
+constexpr strict_t strict{false};
+constexpr strict_t strict_leap_second{true};
+
+error get_flags(std::uint32_t *flags, const char *buf, std::size_t n, strict_t);
+
+error get_flags_prefix(std::uint32_t *flags, std::size_t *consumed, const char *buf, std::size_t n, strict_t);
+
+// finds the first date-time of any format accepted by `get_flags()` anywhere in the text.
+// returns its position and sets `len` and `flags`, or returns `n` when there is no one.
+std::size_t find_dt(const char *buf, std::size_t n, std::size_t *len, std::uint32_t *flags);
+
+// the SIMD kernels of `find_dt()`. the best one supported by the CPU and the OS is selected
+// on the first use. the `DTF_SIMD` environment variable selects the lower one (for testing):
+// `scalar`, `sse2`, `avx2`, `avx512`, the unsupported ones are ignored.
+enum simd_level: std::uint32_t {
+     simd_scalar
+    ,simd_sse2
+    ,simd_avx2
+    ,simd_avx512 // AVX-512BW
+};
+
+// the selected kernel
+simd_level get_simd_level();
+
+const char* simd_level_name(simd_level level);
+
+// parses the date-time string formatted by `to_dt_chars()` with the same `flags`
+// back into the timestamp in nanoseconds. the zone offset, when present, is subtracted.
+error from_dt_chars(std::uint64_t *ts, const char *buf, std::size_t len, std::uint32_t flags = default_flags);
+
+#if __cplusplus >= 201703L
+// accept `std::string` as well
+error get_flags(std::uint32_t *flags, std::string_view str);
+
+error get_flags_prefix(std::uint32_t *flags, std::size_t *consumed, std::string_view str);
+
+error from_dt_chars(std::uint64_t *ts, std::string_view str, std::uint32_t flags = default_flags);
+#else
 error get_flags(std::uint32_t *flags, const std::string &str);
 
+error get_flags_prefix(std::uint32_t *flags, std::size_t *consumed, const std::string &str);
+
+error from_dt_chars(std::uint64_t *ts, const std::string &str, std::uint32_t flags = default_flags);
+#endif // __cplusplus >= 201703L
+
 // dump the flags
 std::ostream& dump_flags(std::ostream &os, std::uint32_t flags, bool with_dtf_prefix = false);
 
 /*************************************************************************************************/
 
+// strftime-like pattern, compiled once into the list of fixed-width ops.
+// supported conversion specifiers:
+// %Y - year, 4 digits              %y - year, 2 digits
+// %m - month [01-12]               %b, %h - abbreviated month name (Jan)
+// %B - full month name (January)   %d - day of month [01-31]
+// %e - day of month, space padded  %j - day of the year [001-366]
+// %a - abbreviated weekday (Sun)   %A - full weekday name (Sunday)
+// %H - hours [00-23]               %I - hours [01-12]
+// %p - AM/PM                       %M - minutes [00-59]
+// %S - seconds [00-59]             %s - seconds since epoch
+// %N - nanoseconds (9 digits)      %3N, %6N, %9N - milli/micro/nanoseconds
+// %F - %Y-%m-%d                    %T - %H:%M:%S
+// %R - %H:%M                       %D - %m/%d/%y
+// %z - +0000                       %Z - GMT
+// %n - '\n'                        %t - '\t'
+// %% - '%'
+class pattern {
+public:
+    enum {
+         max_ops = 32
+        ,max_literals = 64
+    };
+
+    pattern() = default;
+    // the `fmt` MUST be valid
+    explicit pattern(const char *fmt);
+
+    error compile(const char *fmt);
+
+    // the max length of string representation
+    std::size_t max_size() const { return m_max_size; }
+
+    // formats using the compiled pattern.
+    // returns the num of chars placed.
+    // `buf` - the destination buffer with at least `max_size()` bytes.
+    std::size_t format(char *buf, std::uint64_t ts) const;
+
+    std::string format(std::uint64_t ts) const;
+
+    // parses the string using the compiled pattern into the timestamp in nanoseconds.
+    // the literals MUST match exactly, `%B` accepts both the full and the abbreviated names,
+    // `%z` accepts any `+hhmm`/`-hhmm` offset, the weekday names are validated and ignored.
+    // for the patterns without the year (syslog, for example) the year of `ref_ts` is used,
+    // or the previous one if the result would be more than one month ahead of `ref_ts`.
+    // `ref_ts` - the reference timestamp, `0` means the current time.
+    error parse(std::uint64_t *ts, const char *buf, std::size_t len, std::uint64_t ref_ts = 0) const;
+
+    error parse(std::uint64_t *ts, const std::string &str, std::uint64_t ref_ts = 0) const;
+
+private:
+    error compile_impl(const char *fmt);
+    error add_op(std::uint32_t code, std::uint32_t len, std::uint32_t width);
+    error add_literal(const char *str, std::uint32_t len);
+
+    enum op_code: std::uint8_t {
+         op_literal
+        ,op_year4
+        ,op_year2
+        ,op_month
+        ,op_month_abbr
+        ,op_month_name
+        ,op_day
+        ,op_day_space
+        ,op_yday
+        ,op_wday_abbr
+        ,op_wday_name
+        ,op_hours
+        ,op_hours12
+        ,op_ampm
+        ,op_mins
+        ,op_secs
+        ,op_epoch
+        ,op_fraction
+        ,op_zone
+    };
+
+    struct op {
+        std::uint8_t code;
+        std::uint8_t len; // the min length for the variable-width ops
+        std::uint16_t arg;
+    };
+
+    // the string rendered for the latest second.
+    // only the fraction digits are written on the cache hit.
+    struct rendered {
+        std::uint64_t id;
+        std::uint32_t ss;
+        std::uint32_t len;
+        std::uint32_t num_fractions;
+        op fractions[max_ops]; // `arg` is the offset in `buf`
+        char buf[max_ops * 10 + max_literals];
+    };
+
+    std::size_t render(rendered *r, std::uint32_t ss) const;
+
+    op m_ops[max_ops];
+    char m_lits[max_literals];
+    std::uint64_t m_id = 0;
+    std::uint32_t m_num_ops = 0;
+    std::uint32_t m_num_lits = 0;
+    std::uint32_t m_max_size = 0;
+    std::uint32_t m_codes = 0; // the bitmask of `op_code` used
+};
+
+/*************************************************************************************************/
+
+// RFC 7231 HTTP-date: `Sun, 06 Nov 1994 08:49:37 GMT`
+enum {
+    http_date_size = 29
+};
+
+// the per-second cache of HTTP-date which can be shared across threads.
+// the readers never block, the writer which failed to lock just skips the update.
+class http_date_cache {
+public:
+    http_date_cache() = default;
+    http_date_cache(const http_date_cache &) = delete;
+    http_date_cache& operator= (const http_date_cache &) = delete;
+
+private:
+    friend std::size_t to_http_date_chars(char *buf, std::uint64_t ts, http_date_cache &cache);
+
+    // seqlock: odd - the update is in progress
+    std::atomic<std::uint64_t> m_seq{0};
+    std::atomic<std::uint64_t> m_ss{~0ull};
+    std::atomic<std::uint64_t> m_words[4]{};
+};
+
+// formats as HTTP-date.
+// returns the num of chars placed, always `dtf::http_date_size`.
+// `buf` - the destination buffer with at least `dtf::http_date_size` bytes.
+std::size_t to_http_date_chars(char *buf, std::uint64_t ts);
+
+// the same using the shared cache
+std::size_t to_http_date_chars(char *buf, std::uint64_t ts, http_date_cache &cache);
+
+std::string to_http_date_str(std::uint64_t ts);
+
+/*************************************************************************************************/
+
+// maps the readings of the monotonic clock to the wall-clock nanoseconds using the offset
+// sampled by `resample()`, so the cheap monotonic timestamps can be passed to the formatters.
+// the wall clock is slewed by NTP relative to the monotonic one, so `resample()` should be called
+// periodically (from one thread), the mapping itself is lock-free and can be used by any thread.
+//
+// the error of `to_wall(mono)` is at most `max_error(mono)`:
+//     half of the window the latest sample was taken in
+//     + `max_slew_ppm` of the time passed since the latest sample
+// e.g. `1 s` resampling period with the default `500 ppm` (the max frequency adjustment of NTP)
+// gives at most `500 us` + the sampling window. at `resample()` the mapped time may jump
+// by the accumulated slew, at most the same bound, in any direction.
+// the steps of the wall clock (`settimeofday()`) are not bounded and picked up by the next `resample()`.
+class wall_mapper {
+public:
+    using clock_func = std::uint64_t(*)();
+
+    // `std::chrono::steady_clock` in nanoseconds
+    static std::uint64_t steady_now();
+    // `dtf::timestamp()`
+    static std::uint64_t wall_now();
+
+    // `mono` - the monotonic clock which readings will be mapped, e.g. `CLOCK_MONOTONIC_RAW`
+    // `wall` - the wall clock in nanoseconds since epoch
+    explicit wall_mapper(clock_func mono = steady_now, clock_func wall = wall_now, std::uint32_t max_slew_ppm = 500);
+
+    wall_mapper(const wall_mapper &) = delete;
+    wall_mapper& operator= (const wall_mapper &) = delete;
+
+    // samples the offset of the clocks and publishes it.
+    // returns the change of the offset in nanoseconds, the slew or the step since the previous sample.
+    std::int64_t resample();
+
+    // the wall-clock nanoseconds for the reading of the monotonic clock
+    std::uint64_t to_wall(std::uint64_t mono) const {
+        return mono + m_offset.load(std::memory_order_relaxed);
+    }
+
+    // the same for `n` readings at once, `dst` may be the same as `src`
+    void to_wall(std::uint64_t *dst, const std::uint64_t *src, std::size_t n) const;
+
+    // the current wall-clock time read by the monotonic clock
+    std::uint64_t now() const { return to_wall(m_mono()); }
+
+    // the bound of the error of `to_wall(mono)`, nanoseconds
+    std::uint64_t max_error(std::uint64_t mono) const;
+
+private:
+    clock_func m_mono;
+    clock_func m_wall;
+    std::uint32_t m_max_slew_ppm;
+
+    // seqlock: odd - the update is in progress
+    std::atomic<std::uint64_t> m_seq{0};
+    std::atomic<std::uint64_t> m_offset{0};       // `wall - mono`, modulo 2^64
+    std::atomic<std::uint64_t> m_sample_mono{0};
+    std::atomic<std::uint64_t> m_sample_error{0};
+};
+
+/*************************************************************************************************/
+
 } // ns dtf
 
 /*************************************************************************************************/
@@ -161,6 +732,26 @@ std::ostream& dump_flags(std::ostream &os, std::uint32_t flags, bool with_dtf_pr
 
 namespace dtf {
 
+#if defined(_MSC_VER)
+#   define __DTF_NOINLINE __declspec(noinline)
+#elif defined(__GNUC__) || defined(__clang__)
+#   define __DTF_NOINLINE __attribute__((noinline))
+#else
+#   define __DTF_NOINLINE
+#endif
+
+// the definitions of the hot functions are compiled by the `dtf` library only, when it's used
+#if defined(DTF_LIBRARY) && !defined(__DTF_LIBRARY_SOURCE)
+#   define __DTF_LIBRARY_DEFINITIONS 0
+#else
+#   define __DTF_LIBRARY_DEFINITIONS 1
+#endif // DTF_LIBRARY
+#ifdef DTF_LIBRARY
+#   define __DTF_LIBRARY_INLINE
+#else
+#   define __DTF_LIBRARY_INLINE inline
+#endif // DTF_LIBRARY
+
 #if __cplusplus >= 201703L
 #   define __DTF_FALLTHROUGH [[fallthrough]]
 #else
@@ -181,7 +772,6 @@ namespace dtf {
 #define __DTF_MONS_PER_YEAR 12u
 
 #define __DTF_EPOCH_ADJUSTMENT_DAYS 719468
-#define __DTF_ADJUSTED_EPOCH_YEAR   0
 #define __DTF_DAYS_PER_ERA          146097
 #define __DTF_DAYS_PER_4_YEARS      (3 * 365 + 366)
 #define __DTF_DAYS_PER_YEAR         365
@@ -189,14 +779,14 @@ namespace dtf {
 #define __DTF_YEARS_PER_ERA         400
 
 #define __DTF_DHMS(p, v) \
-    std::memcpy(p, digits_lut + (v) * 2, 2); p += 2;
+    std::memcpy(p, luts<>::digits_lut + (v) * 2, 2); p += 2;
 
 #define __DTF_YEAR(p, v) \
-    std::memcpy(p, digits_lut + ((v) / 100) * 2, 2); p += 2; \
-    std::memcpy(p, digits_lut + ((v) % 100) * 2, 2); p += 2;
+    std::memcpy(p, luts<>::digits_lut + ((v) / 100) * 2, 2); p += 2; \
+    std::memcpy(p, luts<>::digits_lut + ((v) % 100) * 2, 2); p += 2;
 
 #define __DTF_MONTH(p, v) \
-    std::memcpy(p, digits_lut + ((v) + 1) * 2, 2); p += 2;
+    std::memcpy(p, luts<>::digits_lut + ((v) + 1) * 2, 2); p += 2;
 
 #define __DTF_DATE_SEP_IS_DASH(ch) (ch == '-')
 #define __DTF_DATE_SEP_IS_POINT(ch) (ch == '.')
@@ -265,6 +855,15 @@ namespace dtf {
         && __DTF_IS_DIGIT(p[6]) && __DTF_IS_DIGIT(p[7]) \
     )
 
+#define __DTF_IS_ZONE_SIGN(ch) (ch == '+' || ch == '-')
+
+#define __DTF_IS_ZONE_OFFSET_VALID(p) \
+    (__DTF_IS_ZONE_SIGN((p)[0]) \
+        && __DTF_IS_DIGIT((p)[1]) && __DTF_IS_DIGIT((p)[2]) \
+        && (p)[3] == ':' \
+        && __DTF_IS_DIGIT((p)[4]) && __DTF_IS_DIGIT((p)[5]) \
+    )
+
 #define __DTF_IS_TIME_NOSEP_VALID(p) \
     (__DTF_IS_DIGIT(p[0]) && __DTF_IS_DIGIT(p[1]) \
         && __DTF_IS_DIGIT(p[2]) && __DTF_IS_DIGIT(p[3]) \
@@ -300,7 +899,28 @@ inline std::uint64_t from_time_t(std::time_t ts) {
 
 /*************************************************************************************************/
 
-static const char digits_lut[200] = {
+// the tables are the static members of the class template to be defined once for all the
+// translation units in every standard, the definitions are placed next to their users
+template<typename = void>
+struct luts {
+    static const char digits_lut[200];
+    static const std::uint32_t pow10_lut[10];
+    static const char base32_alphabet[33];
+    static const char base36_alphabet[37];
+    static const std::uint8_t base32_lut[128];
+    static const std::uint8_t base36_lut[128];
+    static const char date_sep_lut[5];
+    static const char dt_sep_lut[33];
+    static const char time_sep_lut[5];
+    static const char month_abbrs[37];
+    static const char wday_abbrs[22];
+    static const char month_names[12][10];
+    static const std::uint8_t month_name_lens[12];
+    static const char wday_names[7][10];
+    static const std::uint8_t wday_name_lens[7];
+};
+
+template<typename T> const char luts<T>::digits_lut[200] = {
      '0','0','0','1','0','2','0','3','0','4','0','5','0','6','0','7','0','8','0','9'
     ,'1','0','1','1','1','2','1','3','1','4','1','5','1','6','1','7','1','8','1','9'
     ,'2','0','2','1','2','2','2','3','2','4','2','5','2','6','2','7','2','8','2','9'
@@ -313,7 +933,7 @@ static const char digits_lut[200] = {
     ,'9','0','9','1','9','2','9','3','9','4','9','5','9','6','9','7','9','8','9','9'
 };
 
-static std::size_t num_chars(std::size_t v) {
+inline std::size_t num_chars(std::size_t v) {
     std::size_t n = 1;
     v = (v >= 10000000000000000ull) ? ((n += 16), (v / 10000000000000000ull)) : v;
     v = (v >= 100000000ull) ? ((n += 8), (v / 100000000ull)) : v;
@@ -324,11 +944,11 @@ static std::size_t num_chars(std::size_t v) {
     return n;
 }
 
-static void utoa(char *ptr, std::size_t n, std::uint64_t v) {
+inline void utoa(char *ptr, std::size_t n, std::uint64_t v) {
     char *p = ptr + n;
     while ( n >= 2 ) {
         p -= 2;
-        std::memcpy(p, digits_lut + (v % 100) * 2, 2);
+        std::memcpy(p, luts<>::digits_lut + (v % 100) * 2, 2);
         v /= 100;
         n -= 2;
     }
@@ -337,11 +957,11 @@ static void utoa(char *ptr, std::size_t n, std::uint64_t v) {
     }
 }
 
-static void utoa_fixed(char *ptr, std::uint32_t width, std::uint32_t v) {
+inline void utoa_fixed(char *ptr, std::uint32_t width, std::uint32_t v) {
     char *p = ptr + width;
     while ( width >= 2 ) {
         p -= 2;
-        std::memcpy(p, digits_lut + (v % 100) * 2, 2);
+        std::memcpy(p, luts<>::digits_lut + (v % 100) * 2, 2);
         v /= 100;
         width -= 2;
     }
@@ -350,188 +970,1608 @@ static void utoa_fixed(char *ptr, std::uint32_t width, std::uint32_t v) {
     }
 }
 
-/*************************************************************************************************/
+// SWAR: the 8 digits at once.
+// based on: https://lemire.me/blog/2022/01/21/swar-explained-parsing-eight-digits/
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#   define __DTF_SWAR_DIGITS 0
+#else
+#   define __DTF_SWAR_DIGITS 1
+#endif
 
-inline std::size_t to_chars(char *buf, std::uint64_t ts, std::uint32_t f) {
-    ts = (f & flags::secs)
-    ? ts / 1000000000ull
-    : (f & flags::msecs)
-        ? ts / 1000000ull
-        : (f & flags::usecs)
-            ? ts / 1000ull
-            : ts
-    ;
+inline std::uint64_t load_8_digits(const char *p) {
+    std::uint64_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
 
-    const auto n = num_chars(ts);
-    utoa(buf, n, ts);
+inline bool is_8_digits(std::uint64_t v) {
+    return ((v & 0xF0F0F0F0F0F0F0F0ull) == 0x3030303030303030ull)
+        && (((v + 0x0606060606060606ull) & 0xF0F0F0F0F0F0F0F0ull) == 0x3030303030303030ull);
+}
 
-    return n;
+inline std::uint32_t parse_8_digits(std::uint64_t v) {
+    v -= 0x3030303030303030ull;
+    v = (v * 10) + (v >> 8);
+    v = (((v & 0x000000FF000000FFull) * (100 + (1000000ull << 32)))
+        + (((v >> 16) & 0x000000FF000000FFull) * (1 + (10000ull << 32)))) >> 32;
+
+    return static_cast<std::uint32_t>(v);
 }
 
-inline std::string to_str(std::uint64_t ts, std::uint32_t f) {
-    std::string res;
-    res.reserve(bufsize);
+// parses the up to 20 digits. returns `false` for the not a digit or the overflow.
+inline bool parse_u64(std::uint64_t *res, const char *p, std::size_t n) {
+    std::uint64_t v = 0;
+    std::size_t i = 0;
+#if __DTF_SWAR_DIGITS
+    // the 8-digits chunks never overflow, up to 16 digits
+    for ( ; i + 8 <= n && i < 16; i += 8 ) {
+        const std::uint64_t w = load_8_digits(p + i);
+        if ( !is_8_digits(w) ) {
+            return false;
+        }
+        v = v * 100000000ull + parse_8_digits(w);
+    }
+#endif // __DTF_SWAR_DIGITS
+    for ( ; i < n; ++i ) {
+        const std::uint32_t d = static_cast<std::uint32_t>(static_cast<unsigned char>(p[i]) - '0');
+        if ( d > 9 ) {
+            return false;
+        }
+        // only the 20th digit can overflow
+        if ( i == 19 && v > (~0ull - d) / 10 ) {
+            return false;
+        }
+        v = v * 10 + d;
+    }
 
-    const auto n = to_chars(std::addressof(res[0]), ts, f);
-    res.resize(n);
+    *res = v;
 
-    return res;
+    return true;
 }
 
-inline std::string to_str(std::uint32_t f, int offset_in_hours) {
-    const auto ts = timestamp(offset_in_hours);
-    return to_str(ts, f);
+template<typename T> const std::uint32_t luts<T>::pow10_lut[10] = {
+    1u, 10u, 100u, 1000u, 10000u, 100000u, 1000000u, 10000000u, 100000000u, 1000000000u
+};
+
+// parses exactly `n` digits. returns `false` for the not a digit.
+inline bool parse_digits(std::uint32_t *v, const char *p, std::uint32_t n) {
+    std::uint32_t res = 0;
+    for ( std::uint32_t idx = 0; idx < n; ++idx ) {
+        const std::uint32_t d = static_cast<std::uint32_t>(static_cast<unsigned char>(p[idx])) - '0';
+        if ( d > 9 ) {
+            return false;
+        }
+        res = res * 10 + d;
+    }
+    *v = res;
+
+    return true;
+}
+
+// copies the short strings using the overlapping fixed-size moves.
+// the plain `memcpy()` with the variable length is expanded by the compilers into `rep movs`
+// which is much slower for the strings of just a few chars.
+inline void copy_short(char *dst, const char *src, std::size_t n) {
+    if ( n >= 8 ) {
+        for ( std::size_t i = 0; i + 8 < n; i += 8 ) {
+            std::memcpy(dst + i, src + i, 8);
+        }
+        std::memcpy(dst + n - 8, src + n - 8, 8);
+    } else if ( n >= 4 ) {
+        std::memcpy(dst, src, 4);
+        std::memcpy(dst + n - 4, src + n - 4, 4);
+    } else if ( n >= 2 ) {
+        std::memcpy(dst, src, 2);
+        std::memcpy(dst + n - 2, src + n - 2, 2);
+    } else if ( n ) {
+        *dst = *src;
+    }
 }
 
 /*************************************************************************************************/
 
-inline std::size_t to_dt_chars(char *ptr, std::uint64_t ts, std::uint32_t f) {
-    // date_sep: (f>>2)&0x7 -> 1='-', 2='.', 4='~'(empty)
-    static const char date_sep_lut[5] = {0, '-', '.', 0, '~'};
-    // dt_sep: (f>>5)&0x3F -> 1='T', 2='t', 4=' ', 8='_', 16='/', 32='-'
-    static const char dt_sep_lut[33] = {
-         0, 'T', 't', 0, ' ', 0, 0, 0, '_', 0, 0, 0, 0, 0, 0, 0, '/'
-        ,0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, '-'
-    };
-    // time_sep: (f>>11)&0x7 -> 1=':', 2='.', 4='~'(empty)
-    static const char time_sep_lut[5] = {0, ':', '.', 0, '~'};
+// returns the number of days since epoch.
+// `month` - [1-12], `day` - [1-31]
+inline std::int64_t days_from_civil(std::int64_t year, std::uint32_t month, std::uint32_t day) {
+    // based on: https://howardhinnant.github.io/date_algorithms.html#days_from_civil
+    year -= month <= 2;
+    const std::int64_t era = (year >= 0 ? year : year - (__DTF_YEARS_PER_ERA - 1)) / __DTF_YEARS_PER_ERA;
+    const std::int64_t erayear = year - era * __DTF_YEARS_PER_ERA;
+    const std::int64_t yearday = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+    const std::int64_t eraday = erayear * __DTF_DAYS_PER_YEAR + erayear / 4 - erayear / 100 + yearday;
+
+    return era * __DTF_DAYS_PER_ERA + eraday - __DTF_EPOCH_ADJUSTMENT_DAYS;
+}
 
-    constexpr auto date_fmt_mask = yyyy_mm_dd | dd_mm_yyyy;
-    assert(f & date_fmt_mask && "the date format MUST be specified");
-    (void)date_fmt_mask;
-    constexpr auto time_prec_mask = secs | msecs | usecs | nsecs;
-    assert(f & time_prec_mask && "the time precision MUST be specified");
-    (void)time_prec_mask;
+// the inverse of `days_from_civil()` for the days since epoch.
+// `month` - [1-12], `day` - [1-31]
+inline void civil_from_days(std::uint32_t days, std::uint32_t *year, std::uint32_t *month, std::uint32_t *day) {
+    // based on: https://howardhinnant.github.io/date_algorithms.html#civil_from_days
+    // the days are not negative, so the unsigned arithmetic is used
+    const std::uint64_t d = static_cast<std::uint64_t>(days) + __DTF_EPOCH_ADJUSTMENT_DAYS;
+    const std::uint64_t era = d / __DTF_DAYS_PER_ERA;
+    const std::uint32_t eraday = static_cast<std::uint32_t>(d - era * __DTF_DAYS_PER_ERA);
+    const std::uint32_t erayear = (eraday - eraday / (__DTF_DAYS_PER_4_YEARS - 1) + eraday / __DTF_DAYS_PER_CENTURY
+        - eraday / (__DTF_DAYS_PER_ERA - 1)) / __DTF_DAYS_PER_YEAR;
+    const std::uint32_t yearday = eraday - (__DTF_DAYS_PER_YEAR * erayear + erayear / 4 - erayear / 100);
+    const std::uint32_t mp = (5 * yearday + 2) / 153;
+    *day = yearday - (153 * mp + 2) / 5 + 1;
+    *month = mp < 10 ? mp + 3 : mp - 9;
+    *year = static_cast<std::uint32_t>(erayear + era * __DTF_YEARS_PER_ERA) + (*month <= 2);
+}
 
-    constexpr char empty_char = '~';
+inline bool is_leap_year(std::uint32_t year) {
+    return (year % 4 == 0) && (year % 100 != 0 || year % 400 == 0);
+}
 
-    const char datesep = date_sep_lut[(f >> 2) & 0x7];
-    assert(datesep && "the separator type for date MUST be specified!");
+// `month` - [1-12]
+inline std::uint32_t days_in_month(std::uint32_t year, std::uint32_t month) {
+    static const std::uint8_t days[12] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+    return days[month - 1] + static_cast<std::uint32_t>(month == 2 && is_leap_year(year));
+}
 
-    const char dtsep = dt_sep_lut[(f >> 5) & 0x3F];
-    assert(dtsep && "the separator type for date-time MUST be specified!");
+// broken-down representation of the seconds part of timestamp
+struct civil_time {
+    std::uint32_t ss;    // seconds since epoch
+    std::uint32_t year;
+    std::uint32_t month; // [0-11]
+    std::uint32_t day;   // [1-31]
+    std::uint32_t hours;
+    std::uint32_t mins;
+    std::uint32_t secs;
+    std::uint32_t wday;  // [0-6], 0 = Sunday
+    std::uint32_t yday;  // [0-365]
+};
 
-    const char timesep = time_sep_lut[(f >> 11) & 0x7];
-    assert(timesep && "the separator type for time MUST be specified!");
+// sets the time of day part only
+inline void civil_time_of_day(civil_time *ct, std::uint32_t ss) {
+    std::uint32_t rem = ss % __DTF_SECS_PER_DAY;
+    ct->ss = ss;
+    ct->hours = rem / __DTF_SECS_PER_HOUR;
+    rem %= __DTF_SECS_PER_HOUR;
+    ct->mins = rem / __DTF_SECS_PER_MIN;
+    ct->secs = rem % __DTF_SECS_PER_MIN;
+}
 
-    assert(datesep == empty_char ? (dtsep == 'T' || dtsep == 't') : true);
+inline void civil_from_secs(civil_time *ct, std::uint32_t ss) {
+    // the days before the month in the not leap year
+    static const std::uint16_t month_days[12] = {0, 31, 59, 90, 120, 151, 181, 212, 243, 273, 304, 334};
+
+    const std::uint32_t epoch_days = ss / __DTF_SECS_PER_DAY;
+    civil_time_of_day(ct, ss);
+    std::uint32_t year, month, day;
+    civil_from_days(epoch_days, &year, &month, &day);
+    ct->year = year;
+    ct->month = month - 1;
+    ct->day = day;
+    // 01.01.1970 was Thursday
+    ct->wday = (epoch_days + 4) % __DTF_DAYS_PER_WEEK;
+    ct->yday = month_days[month - 1] + day - 1 + static_cast<std::uint32_t>(month > 2 && is_leap_year(year));
+}
 
-    const std::uint32_t ss = ts / __DTF_NSECS_PER_SEC;
-    const std::uint32_t ps = ts % __DTF_NSECS_PER_SEC;
+// the small fully associative cache of the converted seconds.
+// when the second is missed but its day is cached only the time of day is calculated.
+// the aggregate so it can be zero-initialized as `thread_local` without the init guard.
+template<std::size_t N>
+struct civil_cache {
+    static_assert(N > 0, "the cache size can't be zero");
+
+    civil_time entries[N];
+    std::uint32_t size; // the num of valid entries
+    std::uint32_t mru;  // the most recently used entry
+    std::uint32_t next; // the next entry to replace, round-robin
+
+    // `hit` - optional, set to `true` when `ss` was found
+    // `new_day` - optional, set to `true` when the full date conversion was required
+    const civil_time& get(std::uint32_t ss, bool *hit = nullptr, bool *new_day = nullptr) {
+        if ( size != 0 && entries[mru].ss == ss ) {
+            if ( hit ) { *hit = true; }
+            return entries[mru];
+        }
 
-    static thread_local std::uint32_t cached_ss = 0;
-    static thread_local bool cached_valid = false;
-    static thread_local std::size_t cached_year = 0, cached_month = 0, cached_day = 0;
-    static thread_local std::size_t cached_hours = 0, cached_mins = 0, cached_secs = 0;
-
-    std::size_t hours, mins, secs, year, month, day;
-    if ( cached_valid && ss == cached_ss ) {
-        year  = cached_year;
-        month = cached_month;
-        day   = cached_day;
-        hours = cached_hours;
-        mins  = cached_mins;
-        secs  = cached_secs;
-    } else {
-        // based on: https://howardhinnant.github.io/date_algorithms.html#civil_from_days
-        std::uint32_t rem = ss;
-        int days = rem / __DTF_SECS_PER_DAY + __DTF_EPOCH_ADJUSTMENT_DAYS;
-        rem %= __DTF_SECS_PER_DAY;
-        hours = rem / __DTF_SECS_PER_HOUR;
-        rem %= __DTF_SECS_PER_HOUR;
-        mins = rem / __DTF_SECS_PER_MIN;
-        secs = rem % __DTF_SECS_PER_MIN;
-        std::size_t era = (days >= 0 ? days : days - (__DTF_DAYS_PER_ERA - 1)) / __DTF_DAYS_PER_ERA;
-        std::size_t eraday = days - era * __DTF_DAYS_PER_ERA;
-        std::size_t erayear = (eraday - eraday / (__DTF_DAYS_PER_4_YEARS - 1) + eraday / __DTF_DAYS_PER_CENTURY -
-            eraday / (__DTF_DAYS_PER_ERA - 1)) / 365;
-        std::size_t yearday = eraday - (__DTF_DAYS_PER_YEAR * erayear + erayear / 4 - erayear / 100);
-        month = (5 * yearday + 2) / 153;
-        day = yearday - (153 * month + 2) / 5 + 1;
-        month += month < 10 ? 2 : -10;
-        year = __DTF_ADJUSTED_EPOCH_YEAR + erayear + era * __DTF_YEARS_PER_ERA + static_cast<int>(month <= 1);
-
-        cached_ss = ss;
-        cached_year = year;
-        cached_month = month;
-        cached_day = day;
-        cached_hours = hours;
-        cached_mins = mins;
-        cached_secs = secs;
-        cached_valid = true;
+        return get_slow(ss, hit, new_day);
     }
 
-    char *p = ptr;
-    if ( f & flags::yyyy_mm_dd ) {
-        if ( f & flags::date_sep_empty ) {
-            assert(dtsep == 'T' && "'T' MUST be used as date-time separator when used `flags::yyyy_mm_dd|flags::date_sep_empty`");
+    // out of line, so the callers are kept small
+    __DTF_NOINLINE const civil_time& get_slow(std::uint32_t ss, bool *hit, bool *new_day) {
+        for ( std::uint32_t i = 0; i < size; ++i ) {
+            if ( entries[i].ss == ss ) {
+                if ( hit ) { *hit = true; }
+                mru = i;
+                return entries[i];
+            }
         }
-        __DTF_YEAR(p, year);
-        if ( datesep != empty_char ) { *p++ = datesep; }
-        __DTF_MONTH(p, month);
-        if ( datesep != empty_char ) { *p++ = datesep; }
-        __DTF_DHMS(p, day);
-    } else if ( f & flags::dd_mm_yyyy ) {
-        if ( f & flags::date_sep_empty ) {
-            assert(dtsep == 't' && "'t' MUST be used as date-time separator when used `flags::dd_mm_yyyy|flags::date_sep_empty`");
+        if ( hit ) { *hit = false; }
+
+        std::uint32_t idx;
+        if ( size < N ) {
+            idx = size++;
+        } else {
+            // never evict the most recently used one
+            idx = next == mru ? (next + 1) % N : next;
+            next = (idx + 1) % N;
         }
-        __DTF_DHMS(p, day);
-        if ( datesep != empty_char ) { *p++ = datesep; }
-        __DTF_MONTH(p, month);
-        if ( datesep != empty_char ) { *p++ = datesep; }
-        __DTF_YEAR(p, year);
-    } else {
-        assert(!"unreachable");
-    }
 
-    *p++ = dtsep;
+        civil_time *ct = &entries[idx];
+        const std::uint32_t day = ss / __DTF_SECS_PER_DAY;
+        std::uint32_t same_day = N;
+        for ( std::uint32_t i = 0; i < size; ++i ) {
+            if ( i != idx && entries[i].ss / __DTF_SECS_PER_DAY == day ) {
+                same_day = i;
+                break;
+            }
+        }
+        if ( same_day != N ) {
+            *ct = entries[same_day];
+            civil_time_of_day(ct, ss);
+        } else {
+            civil_from_secs(ct, ss);
+        }
+        if ( new_day ) { *new_day = same_day == N; }
+        mru = idx;
 
-    __DTF_DHMS(p, hours);
-    if ( timesep != empty_char ) { *p++ = timesep; }
-    __DTF_DHMS(p, mins);
-    if ( timesep != empty_char ) { *p++ = timesep; }
-    __DTF_DHMS(p, secs);
+        return *ct;
+    }
+};
 
-    std::uint32_t frac_val;
-    std::uint32_t frac_width;
-    if ( f & flags::secs )       { frac_val = 0;              frac_width = 0; }
-    else if ( f & flags::msecs ) { frac_val = ps / 1000000;   frac_width = 3; }
-    else if ( f & flags::usecs ) { frac_val = ps / 1000;      frac_width = 6; }
-    else                         { frac_val = ps;              frac_width = 9; }
+#ifdef DTF_ENABLE_CACHE_STATS
+
+// the counters are written by the owning thread only, so the increments are not atomic RMW,
+// the atomics are for the readers from the other threads only
+struct thread_cache_counters {
+    std::atomic<std::uint64_t> hits{0};
+    std::atomic<std::uint64_t> misses{0};
+    std::atomic<std::uint64_t> new_days{0};
+    // zero - the free entry
+    std::atomic<std::uint32_t> flags[cache_stats_flag_sets];
+    std::atomic<std::uint64_t> calls[cache_stats_flag_sets];
+    std::atomic<std::uint64_t> other_flag_sets_calls{0};
+
+    thread_cache_counters();
+    ~thread_cache_counters();
+    thread_cache_counters(const thread_cache_counters &) = delete;
+    thread_cache_counters& operator= (const thread_cache_counters &) = delete;
+
+    static void inc(std::atomic<std::uint64_t> &c) {
+        c.store(c.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
 
-    if ( frac_width ) {
-        *p++ = '.';
-        utoa_fixed(p, frac_width, frac_val);
-        p += frac_width;
+    void count_flags(std::uint32_t f) {
+        for ( std::size_t i = 0; i < cache_stats_flag_sets; ++i ) {
+            const std::uint32_t it = flags[i].load(std::memory_order_relaxed);
+            if ( it == f ) {
+                inc(calls[i]);
+                return;
+            }
+            if ( it == 0 ) {
+                calls[i].store(1, std::memory_order_relaxed);
+                flags[i].store(f, std::memory_order_release);
+                return;
+            }
+        }
+        inc(other_flag_sets_calls);
     }
 
-    assert((p - ptr) > 0);
+    cache_stats load() const {
+        cache_stats res{};
+        res.hits = hits.load(std::memory_order_relaxed);
+        res.misses = misses.load(std::memory_order_relaxed);
+        res.new_days = new_days.load(std::memory_order_relaxed);
+        for ( std::size_t i = 0; i < cache_stats_flag_sets; ++i ) {
+            const std::uint32_t f = flags[i].load(std::memory_order_acquire);
+            if ( f == 0 ) {
+                break;
+            }
+            res.flag_sets[i].flags = f;
+            res.flag_sets[i].calls = calls[i].load(std::memory_order_relaxed);
+            ++res.num_flag_sets;
+        }
+        res.other_flag_sets_calls = other_flag_sets_calls.load(std::memory_order_relaxed);
+
+        return res;
+    }
+};
+
+// the live threads and the sum of the finished ones
+struct cache_stats_registry {
+    std::mutex mutex;
+    std::vector<const thread_cache_counters *> threads;
+    cache_stats retired{};
+
+    static cache_stats_registry& instance() {
+        static cache_stats_registry registry;
+        return registry;
+    }
+};
+
+inline thread_cache_counters::thread_cache_counters() {
+    for ( std::size_t i = 0; i < cache_stats_flag_sets; ++i ) {
+        flags[i].store(0, std::memory_order_relaxed);
+        calls[i].store(0, std::memory_order_relaxed);
+    }
+
+    cache_stats_registry &registry = cache_stats_registry::instance();
+    std::lock_guard<std::mutex> lock{registry.mutex};
+    registry.threads.push_back(this);
+}
+
+inline thread_cache_counters::~thread_cache_counters() {
+    cache_stats_registry &registry = cache_stats_registry::instance();
+    std::lock_guard<std::mutex> lock{registry.mutex};
+    for ( std::size_t i = 0; i < registry.threads.size(); ++i ) {
+        if ( registry.threads[i] == this ) {
+            registry.threads.erase(registry.threads.begin() + i);
+            break;
+        }
+    }
+    merge_cache_stats(&registry.retired, load());
+}
+
+inline thread_cache_counters& this_thread_cache_counters() {
+    static thread_local thread_cache_counters counters;
+    return counters;
+}
+
+inline cache_stats get_thread_cache_stats() {
+    return this_thread_cache_counters().load();
+}
+
+inline cache_stats get_cache_stats() {
+    cache_stats_registry &registry = cache_stats_registry::instance();
+    std::lock_guard<std::mutex> lock{registry.mutex};
+
+    cache_stats res = registry.retired;
+    for ( const auto *it: registry.threads ) {
+        merge_cache_stats(&res, it->load());
+    }
+
+    return res;
+}
+
+inline void merge_cache_stats(cache_stats *dst, const cache_stats &src) {
+    dst->hits += src.hits;
+    dst->misses += src.misses;
+    dst->new_days += src.new_days;
+    dst->other_flag_sets_calls += src.other_flag_sets_calls;
+
+    for ( std::size_t i = 0; i < src.num_flag_sets; ++i ) {
+        const auto &it = src.flag_sets[i];
+        std::size_t j = 0;
+        for ( ; j < dst->num_flag_sets && dst->flag_sets[j].flags != it.flags; ++j )
+            ;
+        if ( j < dst->num_flag_sets ) {
+            dst->flag_sets[j].calls += it.calls;
+        } else if ( dst->num_flag_sets < cache_stats_flag_sets ) {
+            dst->flag_sets[dst->num_flag_sets++] = it;
+        } else {
+            dst->other_flag_sets_calls += it.calls;
+        }
+    }
+}
+
+#endif // DTF_ENABLE_CACHE_STATS
+
+// the per-thread cache for the latest converted seconds
+inline const civil_time& cached_civil(std::uint32_t ss) {
+    static thread_local civil_cache<DTF_CIVIL_CACHE_SIZE> cache{};
+
+#ifdef DTF_ENABLE_CACHE_STATS
+    bool hit = false, new_day = false;
+    const civil_time &ct = cache.get(ss, &hit, &new_day);
+
+    thread_cache_counters &counters = this_thread_cache_counters();
+    thread_cache_counters::inc(hit ? counters.hits : counters.misses);
+    if ( new_day ) {
+        thread_cache_counters::inc(counters.new_days);
+    }
+
+    return ct;
+#else
+    return cache.get(ss);
+#endif // DTF_ENABLE_CACHE_STATS
+}
+
+struct context {
+    context(): cache{} {}
+
+    civil_cache<DTF_CIVIL_CACHE_SIZE> cache;
+};
+
+// the sources of `civil_time` for the formatting functions
+
+struct thread_civil_source {
+    const civil_time& get(std::uint32_t ss) { return cached_civil(ss); }
+};
+
+struct uncached_civil_source {
+    civil_time ct;
+
+    const civil_time& get(std::uint32_t ss) {
+        civil_from_secs(&ct, ss);
+        return ct;
+    }
+};
+
+// the calls per flag set are counted for the per-thread cache only
+template<typename CivilSource>
+inline void count_source_flags(CivilSource &, std::uint32_t) {}
+
+#ifdef DTF_ENABLE_CACHE_STATS
+inline void count_source_flags(thread_civil_source &, std::uint32_t f) {
+    this_thread_cache_counters().count_flags(f);
+}
+#endif // DTF_ENABLE_CACHE_STATS
+
+/*************************************************************************************************/
+
+#if __DTF_LIBRARY_DEFINITIONS
+__DTF_LIBRARY_INLINE std::size_t to_chars(char *buf, std::uint64_t ts, std::uint32_t f) {
+    ts = (f & flags::secs)
+    ? ts / 1000000000ull
+    : (f & flags::msecs)
+        ? ts / 1000000ull
+        : (f & flags::usecs)
+            ? ts / 1000ull
+            : ts
+    ;
+
+    const auto n = num_chars(ts);
+    utoa(buf, n, ts);
+
+    return n;
+}
+#endif // __DTF_LIBRARY_DEFINITIONS
+
+inline std::string to_str(std::uint64_t ts, std::uint32_t f) {
+    std::string res;
+    res.resize(bufsize);
+
+    const auto n = to_chars(std::addressof(res[0]), ts, f);
+    res.resize(n);
+
+    return res;
+}
+
+inline std::string to_str(std::uint32_t f, int offset_in_hours) {
+    const auto ts = timestamp(offset_in_hours);
+    return to_str(ts, f);
+}
+
+/*************************************************************************************************/
+
+#if __DTF_LIBRARY_DEFINITIONS
+__DTF_LIBRARY_INLINE error from_chars(std::uint64_t *ts, const char *buf, std::size_t len, std::uint32_t f) {
+    if ( len == 0 ) {
+        return error::wrong_number;
+    }
+    // the max is 18446744073709551615
+    if ( len > 20 ) {
+        return std::all_of(buf, buf + len, [](char c) { return __DTF_IS_DIGIT(c); })
+            ? error::number_out_of_range
+            : error::wrong_number
+        ;
+    }
+
+    std::uint64_t v;
+    if ( !parse_u64(&v, buf, len) ) {
+        // the overflow is possible for the 20 digits only
+        return (len == 20 && std::all_of(buf, buf + len, [](char c) { return __DTF_IS_DIGIT(c); }))
+            ? error::number_out_of_range
+            : error::wrong_number
+        ;
+    }
+
+    // the scale and the max value which can be scaled without the overflow
+    std::uint64_t scale = 1ull, max = ~0ull;
+    if ( f & flags::secs ) {
+        scale = 1000000000ull;
+        max = ~0ull / 1000000000ull;
+    } else if ( f & flags::msecs ) {
+        scale = 1000000ull;
+        max = ~0ull / 1000000ull;
+    } else if ( f & flags::usecs ) {
+        scale = 1000ull;
+        max = ~0ull / 1000ull;
+    }
+    if ( v > max ) {
+        return error::number_out_of_range;
+    }
+
+    *ts = v * scale;
+
+    return error::ok;
+}
+#endif // __DTF_LIBRARY_DEFINITIONS
+
+inline error from_chars(std::uint64_t *ts, const std::string &str, std::uint32_t f) {
+    return from_chars(ts, str.c_str(), str.length(), f);
+}
+
+inline std::size_t from_chars(std::uint64_t *ts, const char *const *bufs, const std::size_t *lens, std::size_t n
+    ,std::uint32_t f)
+{
+    for ( std::size_t i = 0; i < n; ++i ) {
+        if ( from_chars(&ts[i], bufs[i], lens[i], f) != error::ok ) {
+            return i;
+        }
+    }
+
+    return n;
+}
+
+/*************************************************************************************************/
+
+// the ASCII order of the alphabets is the order of the digits
+template<typename T> const char luts<T>::base32_alphabet[33] = "0123456789ABCDEFGHJKMNPQRSTVWXYZ";
+template<typename T> const char luts<T>::base36_alphabet[37] = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ";
+
+// the ASCII chars to the digits, 255 for the wrong ones.
+// base32 decodes Crockford's aliases too: `I`, `L` as 1 and `O` as 0.
+template<typename T> const std::uint8_t luts<T>::base32_lut[128] = {
+     255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255
+    ,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255
+    ,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255
+    ,  0,  1,  2,  3,  4,  5,  6,  7,  8,  9,255,255,255,255,255,255
+    ,255, 10, 11, 12, 13, 14, 15, 16, 17,  1, 18, 19,  1, 20, 21,  0
+    , 22, 23, 24, 25, 26,255, 27, 28, 29, 30, 31,255,255,255,255,255
+    ,255, 10, 11, 12, 13, 14, 15, 16, 17,  1, 18, 19,  1, 20, 21,  0
+    , 22, 23, 24, 25, 26,255, 27, 28, 29, 30, 31,255,255,255,255,255
+};
+template<typename T> const std::uint8_t luts<T>::base36_lut[128] = {
+     255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255
+    ,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255
+    ,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255
+    ,  0,  1,  2,  3,  4,  5,  6,  7,  8,  9,255,255,255,255,255,255
+    ,255, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19, 20, 21, 22, 23, 24
+    , 25, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35,255,255,255,255,255
+    ,255, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19, 20, 21, 22, 23, 24
+    , 25, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35,255,255,255,255,255
+};
+
+// 36^6, the max power of 36 which fits into `std::uint32_t`
+#define __DTF_BASE36_6 2176782336u
+
+// the fixed width writers, the width is known at compile time so the loops are unrolled
+template<std::uint32_t Width>
+inline void base32_fixed(char *p, std::uint64_t v) {
+    for ( std::uint32_t i = 0; i < Width; ++i ) {
+        p[i] = luts<>::base32_alphabet[(v >> ((Width - 1 - i) * 5)) & 0x1F];
+    }
+}
+
+// the division by the constant is the multiply-shift, in 32 bits
+template<std::uint32_t Width>
+inline void base36_fixed(char *p, std::uint32_t v) {
+    for ( std::uint32_t i = Width; i; --i ) {
+        p[i - 1] = luts<>::base36_alphabet[v % 36];
+        v /= 36;
+    }
+}
+
+// the independent chunks of 6 digits
+inline void base36_10(char *p, std::uint64_t v) {
+    base36_fixed<4>(p, static_cast<std::uint32_t>(v / __DTF_BASE36_6));
+    base36_fixed<6>(p + 4, static_cast<std::uint32_t>(v % __DTF_BASE36_6));
+}
+
+inline void base36_13(char *p, std::uint64_t v) {
+    const std::uint64_t hi = v / __DTF_BASE36_6;
+    p[0] = luts<>::base36_alphabet[hi / __DTF_BASE36_6];
+    base36_fixed<6>(p + 1, static_cast<std::uint32_t>(hi % __DTF_BASE36_6));
+    base36_fixed<6>(p + 7, static_cast<std::uint32_t>(v % __DTF_BASE36_6));
+}
+
+inline std::size_t sortable_id_size(sortable_id fmt) {
+    return (fmt == id_base32_48 || fmt == id_base36_48) ? 10u : 13u;
+}
+
+inline std::size_t to_sortable_id_chars(char *buf, std::uint64_t v, sortable_id fmt) {
+    assert(((fmt != id_base32_48 && fmt != id_base36_48) || v < (1ull << 48u)) && "the number doesn't fit into 48 bits");
+    switch ( fmt ) {
+        case id_base32_48: base32_fixed<10>(buf, v); return 10;
+        case id_base32_64: base32_fixed<13>(buf, v); return 13;
+        case id_base36_48: base36_10(buf, v); return 10;
+        case id_base36_64: base36_13(buf, v); return 13;
+    }
+    assert(!"unreachable");
+
+    return 0;
+}
+
+inline std::size_t to_sortable_id_chars(char *buf, const std::uint64_t *v, std::size_t n, sortable_id fmt) {
+#ifndef NDEBUG
+    for ( std::size_t i = 0; (fmt == id_base32_48 || fmt == id_base36_48) && i < n; ++i ) {
+        assert(v[i] < (1ull << 48u) && "the number doesn't fit into 48 bits");
+    }
+#endif // NDEBUG
+    // the format is dispatched once
+    switch ( fmt ) {
+        case id_base32_48: for ( std::size_t i = 0; i < n; ++i ) { base32_fixed<10>(buf + i * 10, v[i]); } return n * 10;
+        case id_base32_64: for ( std::size_t i = 0; i < n; ++i ) { base32_fixed<13>(buf + i * 13, v[i]); } return n * 13;
+        case id_base36_48: for ( std::size_t i = 0; i < n; ++i ) { base36_10(buf + i * 10, v[i]); } return n * 10;
+        case id_base36_64: for ( std::size_t i = 0; i < n; ++i ) { base36_13(buf + i * 13, v[i]); } return n * 13;
+    }
+    assert(!"unreachable");
+
+    return 0;
+}
+
+// the digits but the latest one, the wrong chars are collected by OR and checked once by the caller
+template<std::uint32_t Base>
+inline std::uint32_t sortable_id_digits(std::uint64_t *res, const char *p, std::size_t n) {
+    const std::uint8_t *lut = Base == 32 ? luts<>::base32_lut : luts<>::base36_lut;
+    std::uint32_t wrong = 0;
+    std::uint64_t v = 0;
+    for ( std::size_t i = 0; i < n; ++i ) {
+        const std::uint8_t c = static_cast<std::uint8_t>(p[i]);
+        const std::uint32_t d = lut[c & 0x7F];
+        wrong |= d | (c & 0x80u);
+        v = Base == 32 ? (v << 5u) | d : v * Base + d;
+    }
+    *res = v;
+
+    return wrong & 0x80u;
+}
+
+inline error from_sortable_id_chars(std::uint64_t *v, const char *buf, std::size_t len, sortable_id fmt) {
+    const std::size_t size = sortable_id_size(fmt);
+    if ( len != size ) {
+        return len < size ? error::too_short : error::too_long;
+    }
+
+    const bool base32 = fmt == id_base32_48 || fmt == id_base32_64;
+    std::uint64_t res;
+    const std::uint8_t c = static_cast<std::uint8_t>(buf[size - 1]);
+    const std::uint32_t d = (base32 ? luts<>::base32_lut : luts<>::base36_lut)[c & 0x7F];
+    const std::uint32_t wrong = base32
+        ? sortable_id_digits<32>(&res, buf, size - 1)
+        : sortable_id_digits<36>(&res, buf, size - 1)
+    ;
+    if ( (wrong | d | (c & 0x80u)) & 0x80u ) {
+        return error::wrong_number;
+    }
+
+    // the 13 chars are 65 bits of base32 and up to 67 bits of base36
+    if ( fmt == id_base32_64 ? (res >> 59u) != 0 : fmt == id_base36_64 && res > (~0ull - d) / 36 ) {
+        return error::number_out_of_range;
+    }
+    res = base32 ? (res << 5u) | d : res * 36 + d;
+    if ( (fmt == id_base32_48 || fmt == id_base36_48) && (res >> 48u) != 0 ) {
+        return error::number_out_of_range;
+    }
+    *v = res;
+
+    return error::ok;
+}
+
+/*************************************************************************************************/
+
+// the flags known at run time only.
+// `std::integral_constant<std::uint32_t, F>` is used for the ones known at compile time,
+// then all the branches on the flags are folded away.
+struct runtime_flags {
+    std::uint32_t value;
+};
+
+// date_sep: (f>>2)&0x7 -> 1='-', 2='.', 4='~'(empty)
+template<typename T> const char luts<T>::date_sep_lut[5] = {0, '-', '.', 0, '~'};
+// dt_sep: (f>>5)&0x3F -> 1='T', 2='t', 4=' ', 8='_', 16='/', 32='-'
+template<typename T> const char luts<T>::dt_sep_lut[33] = {
+     0, 'T', 't', 0, ' ', 0, 0, 0, '_', 0, 0, 0, 0, 0, 0, 0, '/'
+    ,0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, '-'
+};
+// time_sep: (f>>11)&0x7 -> 1=':', 2='.', 4='~'(empty)
+template<typename T> const char luts<T>::time_sep_lut[5] = {0, ':', '.', 0, '~'};
+
+// the fraction of the second and the zone designator, returns the next position
+inline char* put_fraction_and_zone(char *p, std::uint32_t f, std::uint32_t ps, int offset_in_minutes) {
+    std::uint32_t frac_val;
+    std::uint32_t frac_width;
+    if ( f & flags::secs )       { frac_val = 0;              frac_width = 0; }
+    else if ( f & flags::msecs ) { frac_val = ps / 1000000;   frac_width = 3; }
+    else if ( f & flags::usecs ) { frac_val = ps / 1000;      frac_width = 6; }
+    else                         { frac_val = ps;              frac_width = 9; }
+
+    if ( frac_width ) {
+        *p++ = '.';
+        utoa_fixed(p, frac_width, frac_val);
+        p += frac_width;
+    }
+
+    if ( f & flags::zone_Z ) {
+        *p++ = 'Z';
+    } else if ( f & flags::zone_offset ) {
+        const std::uint32_t offset = static_cast<std::uint32_t>(
+            offset_in_minutes < 0 ? -offset_in_minutes : offset_in_minutes
+        );
+        assert(offset < __DTF_HOURS_PER_DAY * __DTF_MINS_PER_HOUR && "the offset is too big");
+        *p++ = offset_in_minutes < 0 ? '-' : '+';
+        __DTF_DHMS(p, offset / __DTF_MINS_PER_HOUR);
+        *p++ = ':';
+        __DTF_DHMS(p, offset % __DTF_MINS_PER_HOUR);
+    }
+
+    return p;
+}
+
+template<typename Flags, typename CivilSource>
+inline std::size_t to_dt_chars_impl(char *ptr, std::uint64_t ts, Flags flags, int offset_in_minutes, CivilSource &source) {
+    const std::uint32_t f = flags.value;
+    count_source_flags(source, f);
+
+    constexpr auto date_fmt_mask = yyyy_mm_dd | dd_mm_yyyy;
+    assert(f & date_fmt_mask && "the date format MUST be specified");
+    (void)date_fmt_mask;
+    constexpr auto time_prec_mask = secs | msecs | usecs | nsecs;
+    assert(f & time_prec_mask && "the time precision MUST be specified");
+    (void)time_prec_mask;
+
+    constexpr char empty_char = '~';
+
+    const char datesep = luts<>::date_sep_lut[(f >> 2) & 0x7];
+    assert(datesep && "the separator type for date MUST be specified!");
+
+    const char dtsep = luts<>::dt_sep_lut[(f >> 5) & 0x3F];
+    assert(dtsep && "the separator type for date-time MUST be specified!");
+
+    const char timesep = luts<>::time_sep_lut[(f >> 11) & 0x7];
+    assert(timesep && "the separator type for time MUST be specified!");
+
+    assert(datesep == empty_char ? (dtsep == 'T' || dtsep == 't') : true);
+
+    assert(!((f & flags::zone_Z) && offset_in_minutes) && "`dtf::zone_Z` means UTC, the offset MUST be zero");
+    ts += static_cast<std::uint64_t>(
+        static_cast<std::int64_t>(offset_in_minutes) * __DTF_SECS_PER_MIN * static_cast<std::int64_t>(__DTF_NSECS_PER_SEC)
+    );
+
+    const std::uint32_t ss = ts / __DTF_NSECS_PER_SEC;
+    const std::uint32_t ps = ts % __DTF_NSECS_PER_SEC;
+
+    const civil_time &ct = source.get(ss);
+    const std::size_t year = ct.year, month = ct.month, day = ct.day;
+    const std::size_t hours = ct.hours, mins = ct.mins, secs = ct.secs;
+
+    char *p = ptr;
+    if ( f & flags::yyyy_mm_dd ) {
+        if ( f & flags::date_sep_empty ) {
+            assert(dtsep == 'T' && "'T' MUST be used as date-time separator when used `flags::yyyy_mm_dd|flags::date_sep_empty`");
+        }
+        __DTF_YEAR(p, year);
+        if ( datesep != empty_char ) { *p++ = datesep; }
+        __DTF_MONTH(p, month);
+        if ( datesep != empty_char ) { *p++ = datesep; }
+        __DTF_DHMS(p, day);
+    } else if ( f & flags::dd_mm_yyyy ) {
+        if ( f & flags::date_sep_empty ) {
+            assert(dtsep == 't' && "'t' MUST be used as date-time separator when used `flags::dd_mm_yyyy|flags::date_sep_empty`");
+        }
+        __DTF_DHMS(p, day);
+        if ( datesep != empty_char ) { *p++ = datesep; }
+        __DTF_MONTH(p, month);
+        if ( datesep != empty_char ) { *p++ = datesep; }
+        __DTF_YEAR(p, year);
+    } else {
+        assert(!"unreachable");
+    }
+
+    *p++ = dtsep;
+
+    __DTF_DHMS(p, hours);
+    if ( timesep != empty_char ) { *p++ = timesep; }
+    __DTF_DHMS(p, mins);
+    if ( timesep != empty_char ) { *p++ = timesep; }
+    __DTF_DHMS(p, secs);
+
+    p = put_fraction_and_zone(p, f, ps, offset_in_minutes);
+
+    assert((p - ptr) > 0);
+
+    return static_cast<std::size_t>(p - ptr);
+}
+
+#if __DTF_LIBRARY_DEFINITIONS
+__DTF_LIBRARY_INLINE std::size_t to_dt_chars(char *ptr, std::uint64_t ts, std::uint32_t f) {
+    return to_dt_chars(ptr, ts, f, 0);
+}
+
+__DTF_LIBRARY_INLINE std::size_t to_dt_chars(char *ptr, std::uint64_t ts, std::uint32_t f, int offset_in_minutes) {
+    thread_civil_source source;
+    return to_dt_chars_impl(ptr, ts, runtime_flags{f}, offset_in_minutes, source);
+}
+
+__DTF_LIBRARY_INLINE std::size_t to_dt_chars(char *ptr, std::uint64_t ts, std::uint32_t f, context &ctx) {
+    return to_dt_chars_impl(ptr, ts, runtime_flags{f}, 0, ctx.cache);
+}
+
+__DTF_LIBRARY_INLINE std::size_t to_dt_chars(char *ptr, std::uint64_t ts, std::uint32_t f, int offset_in_minutes, context &ctx) {
+    return to_dt_chars_impl(ptr, ts, runtime_flags{f}, offset_in_minutes, ctx.cache);
+}
+
+__DTF_LIBRARY_INLINE std::size_t to_dt_chars(char *ptr, std::uint64_t ts, std::uint32_t f, no_cache_t) {
+    uncached_civil_source source;
+    return to_dt_chars_impl(ptr, ts, runtime_flags{f}, 0, source);
+}
+
+__DTF_LIBRARY_INLINE std::size_t to_dt_chars(char *ptr, std::uint64_t ts, std::uint32_t f, int offset_in_minutes, no_cache_t) {
+    uncached_civil_source source;
+    return to_dt_chars_impl(ptr, ts, runtime_flags{f}, offset_in_minutes, source);
+}
+#endif // __DTF_LIBRARY_DEFINITIONS
+
+/*************************************************************************************************/
+
+inline std::atomic<std::size_t>& tables_memory_counter() {
+    static std::atomic<std::size_t> bytes{0};
+    return bytes;
+}
+
+// "hh?mm?ss" of all the seconds of the day, 8 chars per second, "hhmmss" is padded
+struct time_table {
+    std::size_t len;
+    char chars[__DTF_SECS_PER_DAY * 8];
+
+    // `sep` - zero for `time_sep_empty`
+    explicit time_table(char sep)
+        :len{sep ? 8u : 6u}
+    {
+        char *p = chars;
+        for ( std::uint32_t hh = 0; hh < __DTF_HOURS_PER_DAY; ++hh ) {
+            for ( std::uint32_t mm = 0; mm < __DTF_MINS_PER_HOUR; ++mm ) {
+                for ( std::uint32_t ss = 0; ss < __DTF_SECS_PER_MIN; ++ss ) {
+                    char *t = p;
+                    __DTF_DHMS(t, hh);
+                    if ( sep ) { *t++ = sep; }
+                    __DTF_DHMS(t, mm);
+                    if ( sep ) { *t++ = sep; }
+                    __DTF_DHMS(t, ss);
+                    p += 8;
+                }
+            }
+        }
+        tables_memory_counter() += sizeof(*this);
+    }
+};
+
+// the dates of `2 * DTF_TABLES_DAYS + 1` days around the day of construction, 10 chars per day,
+// "yyyymmdd"/"ddmmyyyy" are padded
+struct date_table {
+    std::uint32_t first_day;
+    std::uint32_t num_days;
+    std::size_t len;
+    char chars[(2 * DTF_TABLES_DAYS + 1) * 10];
+
+    // `style` - the date format and the date separator flags
+    explicit date_table(std::uint32_t style)
+        :first_day{0}
+        ,num_days{2 * DTF_TABLES_DAYS + 1}
+        ,len{(style & flags::date_sep_empty) ? 8u : 10u}
+    {
+        const std::uint32_t today = static_cast<std::uint32_t>(timestamp() / __DTF_NSECS_PER_SEC / __DTF_SECS_PER_DAY);
+        first_day = today > DTF_TABLES_DAYS ? today - DTF_TABLES_DAYS : 0u;
+
+        // the date part of the usual formatting
+        const std::uint32_t f = style
+            | ((style & flags::dd_mm_yyyy) ? flags::dt_sep_t : flags::dt_sep_T)
+            | flags::time_sep_colon
+            | flags::secs
+        ;
+        uncached_civil_source source;
+        for ( std::uint32_t i = 0; i < num_days; ++i ) {
+            char buf[bufsize];
+            const std::uint64_t ts = static_cast<std::uint64_t>(first_day + i) * __DTF_SECS_PER_DAY * __DTF_NSECS_PER_SEC;
+            to_dt_chars_impl(buf, ts, runtime_flags{f}, 0, source);
+            std::memcpy(chars + i * 10, buf, len);
+        }
+        tables_memory_counter() += sizeof(*this);
+    }
+};
+
+// the tables are built on the first use
+inline const time_table& get_time_table(std::uint32_t f) {
+    if ( f & flags::time_sep_colon ) {
+        static const time_table table{':'};
+        return table;
+    }
+    if ( f & flags::time_sep_point ) {
+        static const time_table table{'.'};
+        return table;
+    }
+    static const time_table table{'\0'};
+    return table;
+}
+
+template<std::uint32_t Style>
+inline const date_table& get_date_table() {
+    static const date_table table{Style};
+    return table;
+}
+
+inline const date_table& get_date_table(std::uint32_t f) {
+    if ( f & flags::yyyy_mm_dd ) {
+        return (f & flags::date_sep_dash)
+            ? get_date_table<flags::yyyy_mm_dd|flags::date_sep_dash>()
+            : (f & flags::date_sep_point)
+                ? get_date_table<flags::yyyy_mm_dd|flags::date_sep_point>()
+                : get_date_table<flags::yyyy_mm_dd|flags::date_sep_empty>()
+        ;
+    }
+
+    return (f & flags::date_sep_dash)
+        ? get_date_table<flags::dd_mm_yyyy|flags::date_sep_dash>()
+        : (f & flags::date_sep_point)
+            ? get_date_table<flags::dd_mm_yyyy|flags::date_sep_point>()
+            : get_date_table<flags::dd_mm_yyyy|flags::date_sep_empty>()
+    ;
+}
+
+inline std::size_t to_dt_chars_tables(char *ptr, std::uint64_t ts, std::uint32_t f, int offset_in_minutes) {
+    assert(!((f & flags::zone_Z) && offset_in_minutes) && "`dtf::zone_Z` means UTC, the offset MUST be zero");
+    const std::uint64_t local = ts + static_cast<std::uint64_t>(
+        static_cast<std::int64_t>(offset_in_minutes) * __DTF_SECS_PER_MIN * static_cast<std::int64_t>(__DTF_NSECS_PER_SEC)
+    );
+    const std::uint32_t ss = local / __DTF_NSECS_PER_SEC;
+    const std::uint32_t ps = local % __DTF_NSECS_PER_SEC;
+
+    const date_table &dates = get_date_table(f);
+    const std::uint32_t idx = ss / __DTF_SECS_PER_DAY - dates.first_day;
+    if ( idx >= dates.num_days ) {
+        thread_civil_source source;
+        return to_dt_chars_impl(ptr, ts, runtime_flags{f}, offset_in_minutes, source);
+    }
+    const time_table &times = get_time_table(f);
+
+    // the fixed size copies, the padding is overwritten by the next fields or left past the end
+    char *p = ptr;
+    std::memcpy(p, dates.chars + idx * 10, 10);
+    p += dates.len;
+    *p++ = luts<>::dt_sep_lut[(f >> 5) & 0x3F];
+    std::memcpy(p, times.chars + (ss % __DTF_SECS_PER_DAY) * 8, 8);
+    p += times.len;
+    p = put_fraction_and_zone(p, f, ps, offset_in_minutes);
+
+    return static_cast<std::size_t>(p - ptr);
+}
+
+inline std::size_t to_dt_chars(char *ptr, std::uint64_t ts, std::uint32_t f, tables_t) {
+    return to_dt_chars_tables(ptr, ts, f, 0);
+}
+
+inline std::size_t to_dt_chars(char *ptr, std::uint64_t ts, std::uint32_t f, int offset_in_minutes, tables_t) {
+    return to_dt_chars_tables(ptr, ts, f, offset_in_minutes);
+}
+
+inline std::size_t tables_memory() {
+    return tables_memory_counter().load(std::memory_order_relaxed);
+}
+
+/*************************************************************************************************/
+
+template<std::uint32_t F>
+inline std::size_t to_dt_chars_fixed(char *ptr, std::uint64_t ts) {
+    thread_civil_source source;
+    return to_dt_chars_impl(ptr, ts, std::integral_constant<std::uint32_t, F>{}, 0, source);
+}
+
+/*************************************************************************************************/
+
+inline std::string to_dt_str(std::uint64_t ts, std::uint32_t f) {
+    return to_dt_str(ts, f, 0);
+}
+
+inline std::string to_dt_str(std::uint64_t ts, std::uint32_t f, int offset_in_minutes) {
+    std::string res;
+    res.resize(bufsize);
+
+    const auto n = to_dt_chars(std::addressof(res[0]), ts, f, offset_in_minutes);
+    res.resize(n);
+
+    return res;
+}
+
+inline std::string dt_str(std::uint32_t f, int offset_in_hours) {
+    const auto ts = timestamp(offset_in_hours);
+    return to_dt_str(ts, f);
+}
+
+/*************************************************************************************************/
+
+inline std::size_t dt_chars_size(std::uint32_t f) {
+    // yyyymmdd + `date-time sep` + hhmmss
+    std::size_t len = 8 + 1 + 6;
+    len += (f & flags::date_sep_empty) ? 0 : 2;
+    len += (f & flags::time_sep_empty) ? 0 : 2;
+    len += (f & flags::msecs) ? 4 : (f & flags::usecs) ? 7 : (f & flags::nsecs) ? 10 : 0;
+    len += (f & flags::zone_Z) ? 1 : (f & flags::zone_offset) ? 6 : 0;
+
+    return len;
+}
+
+template<typename Offset>
+inline std::size_t to_dt_column_impl(char *data, Offset *offsets, const std::uint64_t *ts, std::size_t n, std::uint32_t f) {
+    // all the rows are of the same length, so the offsets are known up front
+    const std::size_t len = dt_chars_size(f);
+    assert(offsets[0] >= 0);
+    assert(static_cast<std::uint64_t>(offsets[0]) + n * len
+        <= static_cast<std::uint64_t>(std::numeric_limits<Offset>::max()) && "the offsets overflow");
+
+    // nothing is written, `data` may be null
+    if ( n == 0 ) {
+        return 0;
+    }
+
+    const Offset first = offsets[0];
+    for ( std::size_t i = 1; i <= n; ++i ) {
+        offsets[i] = static_cast<Offset>(first + static_cast<Offset>(i * len));
+    }
+
+    char *p = data + first;
+    thread_civil_source source;
+    for ( std::size_t i = 0; i < n; ++i, p += len ) {
+        const std::size_t placed = to_dt_chars_impl(p, ts[i], runtime_flags{f}, 0, source);
+        assert(placed == len);
+        (void)placed;
+    }
+
+    return n * len;
+}
+
+#if __DTF_LIBRARY_DEFINITIONS
+__DTF_LIBRARY_INLINE std::size_t to_dt_column(char *data, std::int32_t *offsets, const std::uint64_t *ts, std::size_t n, std::uint32_t f) {
+    return to_dt_column_impl(data, offsets, ts, n, f);
+}
+
+__DTF_LIBRARY_INLINE std::size_t to_dt_column(char *data, std::int64_t *offsets, const std::uint64_t *ts, std::size_t n, std::uint32_t f) {
+    return to_dt_column_impl(data, offsets, ts, n, f);
+}
+#endif // __DTF_LIBRARY_DEFINITIONS
+
+/*************************************************************************************************/
+
+template<typename CivilSource>
+inline fields to_fields_impl(std::uint64_t ts, CivilSource &source) {
+    const std::uint32_t ss = static_cast<std::uint32_t>(ts / __DTF_NSECS_PER_SEC);
+    const civil_time &ct = source.get(ss);
+
+    fields res;
+    res.year  = ct.year;
+    res.month = ct.month + 1;
+    res.day   = ct.day;
+    res.hours = ct.hours;
+    res.mins  = ct.mins;
+    res.secs  = ct.secs;
+    res.nsecs = static_cast<std::uint32_t>(ts % __DTF_NSECS_PER_SEC);
+    res.wday  = ct.wday;
+    res.yday  = ct.yday;
+
+    return res;
+}
+
+inline fields to_fields(std::uint64_t ts) {
+    thread_civil_source source;
+    return to_fields_impl(ts, source);
+}
+
+inline fields to_fields(std::uint64_t ts, context &ctx) {
+    return to_fields_impl(ts, ctx.cache);
+}
+
+inline fields to_fields(std::uint64_t ts, no_cache_t) {
+    uncached_civil_source source;
+    return to_fields_impl(ts, source);
+}
+
+inline std::uint64_t from_fields(const fields &f) {
+    assert(f.year >= 1970);
+    assert(f.month >= 1 && f.month <= __DTF_MONS_PER_YEAR);
+    assert(f.day >= 1 && f.day <= days_in_month(f.year, f.month));
+    assert(f.hours < __DTF_HOURS_PER_DAY && f.mins < __DTF_MINS_PER_HOUR && f.secs < __DTF_SECS_PER_MIN);
+    assert(f.nsecs < __DTF_NSECS_PER_SEC);
+
+    // the per-thread cache for the latest converted date
+    static thread_local std::uint32_t cached_date = 0;
+    static thread_local std::int64_t cached_days = 0;
+
+    // never zero for the valid date
+    const std::uint32_t date = (f.year << 9u) | (f.month << 5u) | f.day;
+    if ( date != cached_date ) {
+        cached_days = days_from_civil(f.year, f.month, f.day);
+        cached_date = date;
+    }
+
+    const std::uint64_t ss =
+          static_cast<std::uint64_t>(cached_days) * __DTF_SECS_PER_DAY
+        + f.hours * __DTF_SECS_PER_HOUR
+        + f.mins * __DTF_SECS_PER_MIN
+        + f.secs
+    ;
+
+    return ss * __DTF_NSECS_PER_SEC + f.nsecs;
+}
+
+/*************************************************************************************************/
+
+// [0-99] to the two BCD digits
+inline std::uint64_t to_bcd_2(std::uint32_t v) {
+    return v + (v / 10) * 6;
+}
+
+inline packed_dt to_packed(std::uint64_t ts) {
+    const std::uint32_t ss = static_cast<std::uint32_t>(ts / __DTF_NSECS_PER_SEC);
+    const std::uint32_t cs = static_cast<std::uint32_t>(ts % __DTF_NSECS_PER_SEC / 10000000u);
+    thread_civil_source source;
+    const civil_time &ct = source.get(ss);
+
+    return packed_dt{
+          to_bcd_2(ct.year / 100)  << 56u
+        | to_bcd_2(ct.year % 100)  << 48u
+        | to_bcd_2(ct.month + 1)   << 40u
+        | to_bcd_2(ct.day)         << 32u
+        | to_bcd_2(ct.hours)       << 24u
+        | to_bcd_2(ct.mins)        << 16u
+        | to_bcd_2(ct.secs)        << 8u
+        | to_bcd_2(cs)
+    };
+}
+
+inline std::uint64_t from_packed(packed_dt pdt) {
+    // every byte of two BCD digits to its binary value at once: `hi * 16 + lo - hi * 6`
+    const std::uint64_t v = pdt.value - ((pdt.value >> 4u) & 0x0F0F0F0F0F0F0F0Full) * 6;
+    const auto byte = [v](std::uint32_t i) { return static_cast<std::uint32_t>((v >> (i * 8u)) & 0xFFu); };
+
+    const std::uint32_t year = byte(7) * 100 + byte(6);
+    assert(year >= 1970);
+    assert(byte(5) >= 1 && byte(5) <= __DTF_MONS_PER_YEAR);
+    assert(byte(4) >= 1 && byte(4) <= days_in_month(year, byte(5)));
+    assert(byte(3) < __DTF_HOURS_PER_DAY && byte(2) < __DTF_MINS_PER_HOUR && byte(1) < __DTF_SECS_PER_MIN);
+
+    const std::uint64_t ss =
+          static_cast<std::uint64_t>(days_from_civil(year, byte(5), byte(4))) * __DTF_SECS_PER_DAY
+        + byte(3) * __DTF_SECS_PER_HOUR
+        + byte(2) * __DTF_SECS_PER_MIN
+        + byte(1)
+    ;
+
+    return ss * __DTF_NSECS_PER_SEC + byte(0) * 10000000ull;
+}
+
+// the 8 BCD digits to the 8 ASCII chars, the most significant one first
+inline void bcd_to_chars_8(char *p, std::uint32_t v) {
+#if __DTF_SWAR_DIGITS
+    // the halves, the bytes and the nibbles are swapped into the memory order
+    std::uint64_t x = (static_cast<std::uint64_t>(v & 0xFFFFu) << 32u) | (v >> 16u);
+    x = ((x & 0x000000FF000000FFull) << 16u) | ((x >> 8u) & 0x000000FF000000FFull);
+    x = ((x & 0x000F000F000F000Full) << 8u) | ((x >> 4u) & 0x000F000F000F000Full);
+    x |= 0x3030303030303030ull;
+    std::memcpy(p, &x, sizeof(x));
+#else
+    for ( std::uint32_t i = 0; i < 8; ++i ) {
+        p[i] = static_cast<char>('0' + ((v >> (28u - i * 4u)) & 0xFu));
+    }
+#endif // __DTF_SWAR_DIGITS
+}
+
+inline std::size_t to_dt_chars(char *ptr, packed_dt pdt, std::uint32_t f) {
+    assert(f & (yyyy_mm_dd | dd_mm_yyyy) && "the date format MUST be specified");
+    assert(f & (secs | msecs | usecs | nsecs) && "the time precision MUST be specified");
+
+    constexpr char empty_char = '~';
+    const char datesep = luts<>::date_sep_lut[(f >> 2) & 0x7];
+    assert(datesep && "the separator type for date MUST be specified!");
+    const char dtsep = luts<>::dt_sep_lut[(f >> 5) & 0x3F];
+    assert(dtsep && "the separator type for date-time MUST be specified!");
+    const char timesep = luts<>::time_sep_lut[(f >> 11) & 0x7];
+    assert(timesep && "the separator type for time MUST be specified!");
+    assert(datesep == empty_char ? (dtsep == 'T' || dtsep == 't') : true);
+
+    // "yyyymmdd" and "hhmmsscc"
+    char date[8], time[8];
+    bcd_to_chars_8(date, static_cast<std::uint32_t>(pdt.value >> 32u));
+    bcd_to_chars_8(time, static_cast<std::uint32_t>(pdt.value));
+
+    char *p = ptr;
+    const char *dd = date + 6, *mm = date + 4, *yyyy = date;
+    const bool ymd = (f & flags::yyyy_mm_dd) != 0;
+    std::memcpy(p, ymd ? yyyy : dd, ymd ? 4 : 2);
+    p += ymd ? 4 : 2;
+    if ( datesep != empty_char ) { *p++ = datesep; }
+    std::memcpy(p, mm, 2);
+    p += 2;
+    if ( datesep != empty_char ) { *p++ = datesep; }
+    std::memcpy(p, ymd ? dd : yyyy, ymd ? 2 : 4);
+    p += ymd ? 2 : 4;
+
+    *p++ = dtsep;
+
+    std::memcpy(p, time, 2);
+    p += 2;
+    if ( timesep != empty_char ) { *p++ = timesep; }
+    std::memcpy(p, time + 2, 2);
+    p += 2;
+    if ( timesep != empty_char ) { *p++ = timesep; }
+    std::memcpy(p, time + 4, 2);
+    p += 2;
+
+    if ( !(f & flags::secs) ) {
+        const std::uint32_t width = (f & flags::msecs) ? 3 : (f & flags::usecs) ? 6 : 9;
+        *p++ = '.';
+        std::memcpy(p, time + 6, 2);
+        std::memcpy(p + 2, "0000000", 7);
+        p += width;
+    }
+
+    // the zone only
+    p = put_fraction_and_zone(p, (f & ~(msecs | usecs | nsecs)) | secs, 0, 0);
+
+    return static_cast<std::size_t>(p - ptr);
+}
+
+// the 8 ASCII digits to the 8 BCD digits, the first one is the most significant
+inline std::uint32_t chars_to_bcd_8(const char *p) {
+#if __DTF_SWAR_DIGITS
+    std::uint64_t x;
+    std::memcpy(&x, p, sizeof(x));
+    x &= 0x0F0F0F0F0F0F0F0Full;
+    // the inverse of `bcd_to_chars_8()`: the nibbles, the bytes and the halves
+    x = ((x & 0x000F000F000F000Full) << 4u) | ((x >> 8u) & 0x000F000F000F000Full);
+    x = ((x & 0x000000FF000000FFull) << 8u) | ((x >> 16u) & 0x000000FF000000FFull);
+    return static_cast<std::uint32_t>(((x & 0xFFFFu) << 16u) | ((x >> 32u) & 0xFFFFu));
+#else
+    std::uint32_t v = 0;
+    for ( std::uint32_t i = 0; i < 8; ++i ) {
+        v = (v << 4u) | static_cast<std::uint32_t>(p[i] & 0x0F);
+    }
+    return v;
+#endif // __DTF_SWAR_DIGITS
+}
+
+// the date-time string to "yyyymmdd", "hhmmss" and the 9 digits of fraction, zero padded
+inline void gather_dt_digits(char *date, char *time, char *frac, const char *buf, std::uint32_t f) {
+    const std::size_t date_sep = (f & flags::date_sep_empty) ? 0 : 1;
+    if ( f & flags::yyyy_mm_dd ) {
+        std::memcpy(date, buf, 4);
+        std::memcpy(date + 4, buf + 4 + date_sep, 2);
+        std::memcpy(date + 6, buf + 6 + 2 * date_sep, 2);
+    } else {
+        std::memcpy(date, buf + 4 + 2 * date_sep, 4);
+        std::memcpy(date + 4, buf + 2 + date_sep, 2);
+        std::memcpy(date + 6, buf, 2);
+    }
+
+    const char *t = buf + 8 + 2 * date_sep + 1;
+    const std::size_t time_sep = (f & flags::time_sep_empty) ? 0 : 1;
+    std::memcpy(time, t, 2);
+    std::memcpy(time + 2, t + 2 + time_sep, 2);
+    std::memcpy(time + 4, t + 4 + 2 * time_sep, 2);
+
+    const std::size_t width = (f & flags::msecs) ? 3 : (f & flags::usecs) ? 6 : (f & flags::nsecs) ? 9 : 0;
+    std::memcpy(frac, "000000000", 9);
+    std::memcpy(frac, t + 6 + 2 * time_sep + 1, width);
+}
+
+inline void put_big_endian_8(char *p, std::uint64_t v) {
+    for ( std::size_t i = 0; i < 8; ++i ) {
+        p[i] = static_cast<char>(v >> (56u - i * 8u));
+    }
+}
+
+inline packed_dt sort_key(const char *buf, std::size_t len, std::uint32_t f) {
+    assert(len == dt_chars_size(f) && "the date-time string MUST be valid for the flags");
+    (void)len;
+
+    // "yyyymmdd", "hhmmss" + the fraction
+    char date[8], time[6 + 9 + 1];
+    gather_dt_digits(date, time, time + 6, buf, f);
+
+    return packed_dt{
+        static_cast<std::uint64_t>(chars_to_bcd_8(date)) << 32u | chars_to_bcd_8(time)
+    };
+}
+
+inline void sort_key(char *key, const char *buf, std::size_t len, std::uint32_t f) {
+    assert(len == dt_chars_size(f) && "the date-time string MUST be valid for the flags");
+    (void)len;
+
+    // "hhmmss" + the fraction + the padding digit
+    char date[8], time[6 + 9 + 1];
+    gather_dt_digits(date, time, time + 6, buf, f);
+    time[15] = '0';
+
+    const std::uint64_t hi = static_cast<std::uint64_t>(chars_to_bcd_8(date)) << 32u | chars_to_bcd_8(time);
+    const std::uint64_t lo = static_cast<std::uint64_t>(chars_to_bcd_8(time + 8)) << 32u;
+    put_big_endian_8(key, hi);
+    put_big_endian_8(key + 8, lo);
+}
+
+inline void short_sort_key(char *key, const char *buf, std::size_t len, std::uint32_t f) {
+    put_big_endian_8(key, sort_key(buf, len, f).value);
+}
+
+/*************************************************************************************************/
+
+// the bounds of the calendar bucket, `end` is exclusive
+struct bucket_bounds {
+    std::uint64_t beg;
+    std::uint64_t end;
+
+    bool contains(std::uint64_t ts) const { return ts - beg < end - beg; }
+};
 
-    return static_cast<std::size_t>(p - ptr);
+inline bucket_bounds calendar_bounds(unit u, std::uint64_t ts) {
+    assert(u == unit_month || u == unit_year);
+
+    const std::uint32_t ss = static_cast<std::uint32_t>(ts / __DTF_NSECS_PER_SEC);
+    const civil_time &ct = cached_civil(ss);
+    const std::uint64_t days = ss / __DTF_SECS_PER_DAY;
+
+    std::uint64_t beg_days, num_days;
+    if ( u == unit_month ) {
+        beg_days = days - (ct.day - 1);
+        num_days = days_in_month(ct.year, ct.month + 1);
+    } else {
+        beg_days = days - ct.yday;
+        num_days = __DTF_DAYS_PER_YEAR + static_cast<std::uint64_t>(is_leap_year(ct.year));
+    }
+
+    constexpr std::uint64_t day_ns = __DTF_SECS_PER_DAY * __DTF_NSECS_PER_SEC;
+    return {beg_days * day_ns, (beg_days + num_days) * day_ns};
+}
+
+// the per-thread cache of the latest calendar bucket, so the consecutive
+// timestamps in the same month/year skip the calendar math
+inline const bucket_bounds& cached_calendar_bounds(unit u, std::uint64_t ts) {
+    static thread_local bucket_bounds cached[2]{};
+    bucket_bounds &b = cached[u == unit_year];
+    if ( !b.contains(ts) ) {
+        b = calendar_bounds(u, ts);
+    }
+
+    return b;
+}
+
+// 1970-01-01 was Thursday, so the weeks are counted since 1969-12-29 (Monday)
+#define __DTF_WEEK_SHIFT_NS (3ull * __DTF_SECS_PER_DAY * __DTF_NSECS_PER_SEC)
+#define __DTF_FIRST_MONDAY_NS (4ull * __DTF_SECS_PER_DAY * __DTF_NSECS_PER_SEC)
+
+// the divisors are the constants, so the compiler emits multiply-shift instead of the division.
+// the calendar units are processed by the caller.
+template<bool Ceil>
+inline std::uint64_t round_fixed(unit u, std::uint64_t ts) {
+#define __DTF_ROUND_FIXED_CASE(u, len, shift) \
+    case u: { \
+        const std::uint64_t v = ts + (shift); \
+        const std::uint64_t r = v % (len); \
+        return (Ceil && r != 0 ? v - r + (len) : v - r) - (shift); \
+    }
+
+    switch ( u ) {
+        __DTF_ROUND_FIXED_CASE(unit_second, __DTF_NSECS_PER_SEC, 0)
+        __DTF_ROUND_FIXED_CASE(unit_minute, __DTF_NSECS_PER_SEC * __DTF_SECS_PER_MIN, 0)
+        __DTF_ROUND_FIXED_CASE(unit_hour, __DTF_NSECS_PER_SEC * __DTF_SECS_PER_HOUR, 0)
+        __DTF_ROUND_FIXED_CASE(unit_day, __DTF_NSECS_PER_SEC * __DTF_SECS_PER_DAY, 0)
+        __DTF_ROUND_FIXED_CASE(unit_week, __DTF_NSECS_PER_SEC * __DTF_SECS_PER_DAY * __DTF_DAYS_PER_WEEK, __DTF_WEEK_SHIFT_NS)
+        default: assert(!"unreachable");
+    }
+
+#undef __DTF_ROUND_FIXED_CASE
+
+    return ts;
+}
+
+inline std::uint64_t floor_to(unit u, std::uint64_t ts) {
+    assert(u != unit_week || ts >= __DTF_FIRST_MONDAY_NS);
+
+    if ( u == unit_month || u == unit_year ) {
+        return cached_calendar_bounds(u, ts).beg;
+    }
+
+    return round_fixed<false>(u, ts);
+}
+
+inline std::uint64_t ceil_to(unit u, std::uint64_t ts) {
+    if ( u == unit_month || u == unit_year ) {
+        const bucket_bounds &b = cached_calendar_bounds(u, ts);
+        return b.beg == ts ? ts : b.end;
+    }
+
+    return round_fixed<true>(u, ts);
+}
+
+template<bool Ceil>
+inline void round_batch(unit u, std::uint64_t *dst, const std::uint64_t *src, std::size_t n) {
+    if ( u == unit_month || u == unit_year ) {
+        // the bounds are kept in the registers instead of the thread_local cache
+        bucket_bounds b{0, 0};
+        for ( std::size_t i = 0; i < n; ++i ) {
+            const std::uint64_t ts = src[i];
+            if ( !b.contains(ts) ) {
+                b = calendar_bounds(u, ts);
+            }
+            dst[i] = (Ceil && b.beg != ts) ? b.end : b.beg;
+        }
+
+        return;
+    }
+
+    // the switch is hoisted out of the loop
+    switch ( u ) {
+#define __DTF_ROUND_BATCH_CASE(u) \
+        case u: for ( std::size_t i = 0; i < n; ++i ) { dst[i] = round_fixed<Ceil>(u, src[i]); } break;
+
+        __DTF_ROUND_BATCH_CASE(unit_second)
+        __DTF_ROUND_BATCH_CASE(unit_minute)
+        __DTF_ROUND_BATCH_CASE(unit_hour)
+        __DTF_ROUND_BATCH_CASE(unit_day)
+        __DTF_ROUND_BATCH_CASE(unit_week)
+        default: assert(!"unreachable");
+
+#undef __DTF_ROUND_BATCH_CASE
+    }
+}
+
+inline void floor_to(unit u, std::uint64_t *dst, const std::uint64_t *src, std::size_t n) {
+#ifndef NDEBUG
+    for ( std::size_t i = 0; u == unit_week && i < n; ++i ) {
+        assert(src[i] >= __DTF_FIRST_MONDAY_NS);
+    }
+#endif // NDEBUG
+
+    round_batch<false>(u, dst, src, n);
+}
+
+inline void ceil_to(unit u, std::uint64_t *dst, const std::uint64_t *src, std::size_t n) {
+    round_batch<true>(u, dst, src, n);
 }
 
 /*************************************************************************************************/
 
-inline std::string to_dt_str(std::uint64_t ts, std::uint32_t f) {
-    std::string res;
-    res.resize(bufsize);
+#define __DTF_NSECS_PER_DAY (__DTF_SECS_PER_DAY * __DTF_NSECS_PER_SEC)
 
-    const auto n = to_dt_chars(std::addressof(res[0]), ts, f);
-    res.resize(n);
+// the num of months since the year 0, the day and the time of day
+struct civil_month {
+    std::int64_t months;
+    std::uint32_t day;
+    std::uint64_t time_of_day;
+};
 
-    return res;
+inline civil_month to_civil_month(std::uint64_t ts) {
+    std::uint32_t year, month, day;
+    civil_from_days(static_cast<std::uint32_t>(ts / __DTF_NSECS_PER_DAY), &year, &month, &day);
+
+    return {static_cast<std::int64_t>(year) * __DTF_MONS_PER_YEAR + month - 1, day, ts % __DTF_NSECS_PER_DAY};
 }
 
-inline std::string dt_str(std::uint32_t f, int offset_in_hours) {
-    const auto ts = timestamp(offset_in_hours);
-    return to_dt_str(ts, f);
+inline std::uint64_t from_civil_month(const civil_month &cm) {
+    assert(cm.months >= 1970 * __DTF_MONS_PER_YEAR && "the result is earlier than the epoch");
+    const std::uint32_t year = static_cast<std::uint32_t>(cm.months / __DTF_MONS_PER_YEAR);
+    const std::uint32_t month = static_cast<std::uint32_t>(cm.months % __DTF_MONS_PER_YEAR) + 1;
+    const std::uint32_t day = std::min(cm.day, days_in_month(year, month));
+
+    return static_cast<std::uint64_t>(days_from_civil(year, month, day)) * __DTF_NSECS_PER_DAY + cm.time_of_day;
+}
+
+inline std::uint64_t add_months(std::uint64_t ts, std::int32_t months) {
+    civil_month cm = to_civil_month(ts);
+    cm.months += months;
+
+    return from_civil_month(cm);
+}
+
+inline std::uint64_t add_years(std::uint64_t ts, std::int32_t years) {
+    return add_months(ts, years * static_cast<std::int32_t>(__DTF_MONS_PER_YEAR));
+}
+
+inline std::uint32_t days_in_month(std::uint64_t ts) {
+    std::uint32_t year, month, day;
+    civil_from_days(static_cast<std::uint32_t>(ts / __DTF_NSECS_PER_DAY), &year, &month, &day);
+
+    return days_in_month(year, month);
+}
+
+inline std::uint64_t next_weekday(std::uint64_t ts, std::uint32_t wday) {
+    assert(wday < __DTF_DAYS_PER_WEEK);
+    // 01.01.1970 was Thursday
+    const std::uint32_t cur = static_cast<std::uint32_t>((ts / __DTF_NSECS_PER_DAY + 4) % __DTF_DAYS_PER_WEEK);
+    const std::uint32_t delta = (wday + __DTF_DAYS_PER_WEEK - 1 - cur) % __DTF_DAYS_PER_WEEK + 1;
+
+    return ts + delta * __DTF_NSECS_PER_DAY;
+}
+
+inline void add_months(std::uint64_t *dst, const std::uint64_t *src, std::size_t n, std::int32_t months) {
+    // the consecutive timestamps of the same day share the date conversion
+    std::uint64_t day = ~0ull, res_day = 0;
+    for ( std::size_t i = 0; i < n; ++i ) {
+        const std::uint64_t ts = src[i];
+        const std::uint64_t time_of_day = ts % __DTF_NSECS_PER_DAY;
+        if ( ts - time_of_day != day ) {
+            day = ts - time_of_day;
+            res_day = add_months(day, months);
+        }
+        dst[i] = res_day + time_of_day;
+    }
+}
+
+inline void add_years(std::uint64_t *dst, const std::uint64_t *src, std::size_t n, std::int32_t years) {
+    add_months(dst, src, n, years * static_cast<std::int32_t>(__DTF_MONS_PER_YEAR));
+}
+
+inline void next_weekday(std::uint64_t *dst, const std::uint64_t *src, std::size_t n, std::uint32_t wday) {
+    // the consecutive timestamps of the same day share the result
+    std::uint64_t day = ~0ull, res_day = 0;
+    for ( std::size_t i = 0; i < n; ++i ) {
+        const std::uint64_t ts = src[i];
+        const std::uint64_t time_of_day = ts % __DTF_NSECS_PER_DAY;
+        if ( ts - time_of_day != day ) {
+            day = ts - time_of_day;
+            res_day = next_weekday(day, wday);
+        }
+        dst[i] = res_day + time_of_day;
+    }
 }
 
 /*************************************************************************************************/
 
-inline error get_flags(std::uint32_t *flags, const char *buf, std::size_t len) {
+#if __DTF_LIBRARY_DEFINITIONS
+// the two digits as the number ordered as the digits are: "59" -> 0x3539
+inline std::uint32_t digit_pair(const char *p) {
+    return (static_cast<std::uint32_t>(static_cast<std::uint8_t>(p[0])) << 8u) | static_cast<std::uint8_t>(p[1]);
+}
+
+// the values of the fields of the date-time which chars are checked already.
+// the digit pairs are compared as is, without the parsing, and the results are combined
+// without the branches.
+inline bool is_dt_values_valid(const char *year, const char *month, const char *day, const char *time
+    ,std::size_t time_sep, bool leap_second)
+{
+    // the digit pairs of the num of days per month, the February of the leap year is +1
+    static const std::uint16_t days_lut[13] = {
+        0x3030, 0x3331, 0x3238, 0x3331, 0x3330, 0x3331, 0x3330, 0x3331, 0x3331, 0x3330, 0x3331, 0x3330, 0x3331
+    };
+
+    const std::uint32_t mm = digit_pair(month);
+    const bool month_ok = mm - 0x3031u <= 0x3132u - 0x3031u; // [01-12]
+    // "1x" -> 10 + x, the wrong month is mapped to zero
+    const std::uint32_t m = ((mm >> 8u) & 1u) * 10u + (mm & 0x0Fu);
+    const std::uint32_t days_idx = month_ok ? m : 0u;
+
+    // the century year is leap when the century is divisible by 4.
+    // the num is divisible by 4 when its last digit and twice its tens digit are
+    const std::uint32_t yy = ((year[2] - '0') << 1u) + (year[3] - '0');
+    const std::uint32_t cc = ((year[0] - '0') << 1u) + (year[1] - '0');
+    const bool century = year[2] == '0' && year[3] == '0';
+    const bool leap = ((century ? cc : yy) & 3u) == 0;
+    const std::uint32_t days = days_lut[days_idx] + ((days_idx == 2) & leap);
+
+    const char *mins = time + 2 + time_sep;
+    const char *secs = mins + 2 + time_sep;
+
+    return month_ok
+        & (digit_pair(day) - 0x3031u <= days - 0x3031u)                 // [01-days]
+        & (digit_pair(time) <= 0x3233u)                                 // [00-23]
+        & (digit_pair(mins) <= 0x3539u)                                 // [00-59]
+        & (digit_pair(secs) <= (leap_second ? 0x3630u : 0x3539u))       // [00-59] or [00-60]
+    ;
+}
+
+template<bool Strict>
+inline error get_flags_impl(std::uint32_t *flags, const char *buf, std::size_t len, bool leap_second) {
     *flags = 0u;
 
+    // the zone designator suffix, the rest is processed as usual
+    std::uint32_t zone = 0u;
+    if ( len >= 1 && buf[len - 1] == 'Z' ) {
+        zone = flags::zone_Z;
+        len -= 1;
+    } else if ( len >= 6 && __DTF_IS_ZONE_SIGN(buf[len - 6]) && buf[len - 3] == ':' ) {
+        if ( !__DTF_IS_ZONE_OFFSET_VALID(buf + len - 6) ) {
+            return error::wrong_zone_offset;
+        }
+        if ( Strict && (digit_pair(buf + len - 5) > 0x3233u || digit_pair(buf + len - 2) > 0x3539u) ) {
+            return error::wrong_dt_value;
+        }
+        zone = flags::zone_offset;
+        len -= 6;
+    }
+
     if ( len < 15 ) {
         return error::too_short;
     }
@@ -616,7 +2656,8 @@ inline error get_flags(std::uint32_t *flags, const char *buf, std::size_t len) {
                 : flags::date_sep_point
             ;
         } else {
-            assert(!"unreachable!");
+            // the date-time separator at 10, but no date separator
+            return error::wrong_yyyy_mm_dd_sep;
         }
 
         (*flags) |= __DTF_DATETIME_SEP_IS_T(ch10)
@@ -637,6 +2678,9 @@ inline error get_flags(std::uint32_t *flags, const char *buf, std::size_t len) {
     // time sep processing
     if ( __DTF_IS_TIME_SEPARATOR(buf[dt_sep_pos + 1 + 2]) ) {
         // time WITH separator
+        if ( dt_sep_pos + 1 + 8 > len ) {
+            return error::too_short;
+        }
         const char *ptr = buf + dt_sep_pos + 1;
         bool valid = __DTF_IS_TIME_SEP_VALID(ptr);
         if ( !valid ) {
@@ -658,6 +2702,9 @@ inline error get_flags(std::uint32_t *flags, const char *buf, std::size_t len) {
         ;
     } else {
         // time without separator
+        if ( dt_sep_pos + 1 + 6 > len ) {
+            return error::too_short;
+        }
         const char *ptr = buf + dt_sep_pos + 1;
         bool valid = __DTF_IS_TIME_NOSEP_VALID(ptr);
         if ( !valid ) {
@@ -673,7 +2720,8 @@ inline error get_flags(std::uint32_t *flags, const char *buf, std::size_t len) {
         ;
     }
 
-    const char eos_char = buf[eos_time_pos];
+    // nothing is read past `len`, so the string may be not terminated
+    const char eos_char = eos_time_pos == len ? '\0' : buf[eos_time_pos];
     if ( eos_char == '.' ) {
         auto chars_left = len - eos_time_pos - 1;
         if ( chars_left % 3 != 0 ) {
@@ -704,19 +2752,552 @@ inline error get_flags(std::uint32_t *flags, const char *buf, std::size_t len) {
                 break;
             }
         }
-    } else if ( eos_char == '\0' ) {
-        (*flags) |= flags::secs;
-    } else {
-        return error::wrong_dt_end_char;
+    } else if ( eos_time_pos == len ) {
+        (*flags) |= flags::secs;
+    } else {
+        return error::wrong_dt_end_char;
+    }
+
+    if ( Strict ) {
+        // the positions of the fields are known by the layout found above
+        const bool ymd = ((*flags) & flags::yyyy_mm_dd) != 0;
+        const std::size_t date_sep = dt_sep_pos == 10u ? 1u : 0u;
+        const char *year = ymd ? buf : buf + 4 + 2 * date_sep;
+        const char *month = buf + (ymd ? 4 : 2) + date_sep;
+        const char *day = ymd ? buf + 6 + 2 * date_sep : buf;
+        const std::size_t time_sep = ((*flags) & flags::time_sep_empty) ? 0u : 1u;
+        if ( !is_dt_values_valid(year, month, day, buf + dt_sep_pos + 1, time_sep, leap_second) ) {
+            return error::wrong_dt_value;
+        }
+    }
+
+    (*flags) |= zone;
+
+    return error::ok;
+}
+
+__DTF_LIBRARY_INLINE error get_flags(std::uint32_t *flags, const char *buf, std::size_t len) {
+    return get_flags_impl<false>(flags, buf, len, false);
+}
+
+__DTF_LIBRARY_INLINE error get_flags(std::uint32_t *flags, const char *buf, std::size_t len, strict_t mode) {
+    return get_flags_impl<true>(flags, buf, len, mode.leap_second);
+}
+
+// checks the first `n` chars as the whole date-time
+template<bool Strict>
+inline error finish_flags_prefix(std::uint32_t *flags, std::size_t *consumed, const char *buf, std::size_t n
+    ,bool leap_second)
+{
+    const error err = get_flags_impl<Strict>(flags, buf, n, leap_second);
+    *consumed = err == error::ok ? n : 0u;
+
+    return err;
+}
+
+template<bool Strict>
+inline error get_flags_prefix_impl(std::uint32_t *flags, std::size_t *consumed, const char *buf, std::size_t len
+    ,bool leap_second)
+{
+    *flags = 0u;
+    *consumed = 0u;
+
+    // the length is found by the positions of the separators, the layout is checked by `get_flags()`
+    if ( len < 15 ) {
+        return error::too_short;
+    }
+
+    const std::size_t dt_sep_pos = __DTF_IS_DT_SEPARATOR(buf[8])
+        ? 8u
+        : __DTF_IS_DT_SEPARATOR(buf[10])
+            ? 10u
+            : 0u
+    ;
+    if ( dt_sep_pos == 0 ) {
+        return error::wrong_dt_sep;
+    }
+
+    std::size_t n = dt_sep_pos + 1;
+    n += __DTF_IS_TIME_SEPARATOR(buf[n + 2]) ? 8u : 6u;
+    if ( n > len ) {
+        return error::too_short;
+    }
+
+    // the malformed suffixes are not consumed, the prefix is the longest valid date-time
+    if ( n < len && buf[n] == '.' ) {
+        std::size_t digits = 0;
+        for ( ; n + 1 + digits < len && digits < 10 && __DTF_IS_DIGIT(buf[n + 1 + digits]); ++digits )
+            ;
+        if ( digits != 3 && digits != 6 && digits != 9 ) {
+            return finish_flags_prefix<Strict>(flags, consumed, buf, n, leap_second);
+        }
+        n += 1 + digits;
+    }
+
+    std::size_t zone_len = 0;
+    if ( n < len && buf[n] == 'Z' ) {
+        zone_len = 1;
+    } else if ( n + 6 <= len && __DTF_IS_ZONE_SIGN(buf[n]) && buf[n + 3] == ':' ) {
+        zone_len = 6;
+    }
+
+    const error err = finish_flags_prefix<Strict>(flags, consumed, buf, n + zone_len, leap_second);
+
+    return err == error::wrong_zone_offset
+        ? finish_flags_prefix<Strict>(flags, consumed, buf, n, leap_second)
+        : err
+    ;
+}
+
+__DTF_LIBRARY_INLINE error get_flags_prefix(std::uint32_t *flags, std::size_t *consumed, const char *buf, std::size_t len) {
+    return get_flags_prefix_impl<false>(flags, consumed, buf, len, false);
+}
+
+__DTF_LIBRARY_INLINE error get_flags_prefix(std::uint32_t *flags, std::size_t *consumed, const char *buf, std::size_t len
+    ,strict_t mode)
+{
+    return get_flags_prefix_impl<true>(flags, consumed, buf, len, mode.leap_second);
+}
+#endif // __DTF_LIBRARY_DEFINITIONS
+
+/*************************************************************************************************/
+
+// the date part of the candidate matches its layout, at least 15 chars are available
+inline bool is_dt_date(const char *p) {
+    return (__DTF_IS_DATE_SEPARATOR(p[4]) && p[7] == p[4] && __DTF_IS_YYYY_MM_DD_SEP_VALID(p))
+        || (__DTF_IS_DATE_SEPARATOR(p[2]) && p[5] == p[2] && __DTF_IS_DD_MM_YYYY_SEP_VALID(p))
+        || (__DTF_IS_DT_SEPARATOR(p[8]) && __DTF_IS_YYYY_MM_DD_NOSEP_VALID(p))
+    ;
+}
+
+#ifdef __DTF_SSE2
+
+inline std::uint32_t count_trailing_zeros(std::uint32_t v) {
+#ifdef _MSC_VER
+    unsigned long idx;
+    _BitScanForward(&idx, v);
+    return idx;
+#else
+    return static_cast<std::uint32_t>(__builtin_ctz(v));
+#endif // _MSC_VER
+}
+
+#ifdef __DTF_AVX
+inline std::uint32_t count_trailing_zeros(std::uint64_t v) {
+#ifdef _MSC_VER
+    unsigned long idx;
+    _BitScanForward64(&idx, v);
+    return idx;
+#else
+    return static_cast<std::uint32_t>(__builtin_ctzll(v));
+#endif // _MSC_VER
+}
+#endif // __DTF_AVX
+
+// the mask of the candidates starting at `p[0..15]`, reads `p[0..23]`:
+// the digit followed by the date separators at 4 and 7 (yyyy-mm-dd) or at 2 and 5 (dd-mm-yyyy),
+// or the digits at 4 and 7 followed by the date-time separator at 8 (yyyymmdd).
+inline std::uint32_t find_dt_candidates(const char *p) {
+    const auto load = [p](std::size_t off) {
+        return _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + off));
+    };
+    const auto eq = [](__m128i v, char ch) {
+        return _mm_cmpeq_epi8(v, _mm_set1_epi8(ch));
+    };
+    const auto digit = [](__m128i v) {
+        const __m128i d = _mm_sub_epi8(v, _mm_set1_epi8('0'));
+        return _mm_cmpeq_epi8(_mm_min_epu8(d, _mm_set1_epi8(9)), d);
+    };
+    const auto date_sep = [&eq](__m128i v) {
+        return _mm_or_si128(eq(v, '-'), eq(v, '.'));
+    };
+    const auto dt_sep = [&eq](__m128i v) {
+        return _mm_or_si128(
+             _mm_or_si128(_mm_or_si128(eq(v, 'T'), eq(v, 't')), _mm_or_si128(eq(v, ' '), eq(v, '_')))
+            ,_mm_or_si128(eq(v, '/'), eq(v, '-'))
+        );
+    };
+
+    const __m128i v4 = load(4);
+    const __m128i v7 = load(7);
+    const __m128i ymd = _mm_and_si128(date_sep(v4), date_sep(v7));
+    const __m128i dmy = _mm_and_si128(date_sep(load(2)), date_sep(load(5)));
+    const __m128i nosep = _mm_and_si128(_mm_and_si128(digit(v4), digit(v7)), dt_sep(load(8)));
+    const __m128i mask = _mm_and_si128(digit(load(0)), _mm_or_si128(_mm_or_si128(ymd, dmy), nosep));
+
+    return static_cast<std::uint32_t>(_mm_movemask_epi8(mask));
+}
+
+#endif // __DTF_SSE2
+
+#ifdef __DTF_AVX
+
+// the kernels are compiled for their targets, the callers must check `get_simd_level()`.
+// the lambdas don't inherit the target, so the helpers are the functions.
+#ifdef _MSC_VER
+#   define __DTF_TARGET(t)
+#else
+#   define __DTF_TARGET(t) __attribute__((target(t)))
+#endif // _MSC_VER
+
+__DTF_TARGET("avx2") inline __m256i avx2_load(const char *p) {
+    return _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+}
+
+__DTF_TARGET("avx2") inline __m256i avx2_eq(__m256i v, char ch) {
+    return _mm256_cmpeq_epi8(v, _mm256_set1_epi8(ch));
+}
+
+__DTF_TARGET("avx2") inline __m256i avx2_digit(__m256i v) {
+    const __m256i d = _mm256_sub_epi8(v, _mm256_set1_epi8('0'));
+    return _mm256_cmpeq_epi8(_mm256_min_epu8(d, _mm256_set1_epi8(9)), d);
+}
+
+__DTF_TARGET("avx2") inline __m256i avx2_date_sep(__m256i v) {
+    return _mm256_or_si256(avx2_eq(v, '-'), avx2_eq(v, '.'));
+}
+
+__DTF_TARGET("avx2") inline __m256i avx2_dt_sep(__m256i v) {
+    return _mm256_or_si256(
+         _mm256_or_si256(_mm256_or_si256(avx2_eq(v, 'T'), avx2_eq(v, 't')), _mm256_or_si256(avx2_eq(v, ' '), avx2_eq(v, '_')))
+        ,_mm256_or_si256(avx2_eq(v, '/'), avx2_eq(v, '-'))
+    );
+}
+
+// the same as `find_dt_candidates()` for `p[0..31]`, reads `p[0..39]`
+__DTF_TARGET("avx2") inline std::uint32_t find_dt_candidates_avx2(const char *p) {
+    const __m256i v4 = avx2_load(p + 4);
+    const __m256i v7 = avx2_load(p + 7);
+    const __m256i ymd = _mm256_and_si256(avx2_date_sep(v4), avx2_date_sep(v7));
+    const __m256i dmy = _mm256_and_si256(avx2_date_sep(avx2_load(p + 2)), avx2_date_sep(avx2_load(p + 5)));
+    const __m256i nosep = _mm256_and_si256(_mm256_and_si256(avx2_digit(v4), avx2_digit(v7)), avx2_dt_sep(avx2_load(p + 8)));
+    const __m256i mask = _mm256_and_si256(avx2_digit(avx2_load(p)), _mm256_or_si256(_mm256_or_si256(ymd, dmy), nosep));
+
+    return static_cast<std::uint32_t>(_mm256_movemask_epi8(mask));
+}
+
+__DTF_TARGET("avx512f,avx512bw") inline __m512i avx512_load(const char *p) {
+    return _mm512_loadu_si512(p);
+}
+
+__DTF_TARGET("avx512f,avx512bw") inline __mmask64 avx512_eq(__m512i v, char ch) {
+    return _mm512_cmpeq_epi8_mask(v, _mm512_set1_epi8(ch));
+}
+
+__DTF_TARGET("avx512f,avx512bw") inline __mmask64 avx512_digit(__m512i v) {
+    return _mm512_cmple_epu8_mask(_mm512_sub_epi8(v, _mm512_set1_epi8('0')), _mm512_set1_epi8(9));
+}
+
+__DTF_TARGET("avx512f,avx512bw") inline __mmask64 avx512_date_sep(__m512i v) {
+    return avx512_eq(v, '-') | avx512_eq(v, '.');
+}
+
+__DTF_TARGET("avx512f,avx512bw") inline __mmask64 avx512_dt_sep(__m512i v) {
+    return avx512_eq(v, 'T') | avx512_eq(v, 't') | avx512_eq(v, ' ')
+        | avx512_eq(v, '_') | avx512_eq(v, '/') | avx512_eq(v, '-')
+    ;
+}
+
+// the same as `find_dt_candidates()` for `p[0..63]`, reads `p[0..71]`
+__DTF_TARGET("avx512f,avx512bw") inline std::uint64_t find_dt_candidates_avx512(const char *p) {
+    const __m512i v4 = avx512_load(p + 4);
+    const __m512i v7 = avx512_load(p + 7);
+    const __mmask64 ymd = avx512_date_sep(v4) & avx512_date_sep(v7);
+    const __mmask64 dmy = avx512_date_sep(avx512_load(p + 2)) & avx512_date_sep(avx512_load(p + 5));
+    const __mmask64 nosep = avx512_digit(v4) & avx512_digit(v7) & avx512_dt_sep(avx512_load(p + 8));
+
+    return avx512_digit(avx512_load(p)) & (ymd | dmy | nosep);
+}
+
+#undef __DTF_TARGET
+
+#endif // __DTF_AVX
+
+#if __DTF_LIBRARY_DEFINITIONS
+__DTF_LIBRARY_INLINE const char* simd_level_name(simd_level level) {
+    switch ( level ) {
+        case simd_scalar: return "scalar";
+        case simd_sse2  : return "sse2";
+        case simd_avx2  : return "avx2";
+        case simd_avx512: return "avx512";
+    }
+
+    return "unknown";
+}
+
+// the best kernel supported by the CPU and the OS
+inline simd_level detect_simd_level() {
+#if defined(__DTF_AVX) && defined(_MSC_VER)
+    int regs[4];
+    __cpuid(regs, 0);
+    if ( regs[0] < 7 ) {
+        return simd_sse2;
+    }
+    __cpuid(regs, 1);
+    const bool osxsave = (regs[2] & (1 << 27)) != 0;
+    if ( !osxsave ) {
+        return simd_sse2;
+    }
+    const unsigned long long xcr0 = _xgetbv(0);
+    __cpuidex(regs, 7, 0);
+    if ( (xcr0 & 0xe6) == 0xe6 && (regs[1] & (1 << 16)) && (regs[1] & (1 << 30)) ) {
+        return simd_avx512;
+    }
+    if ( (xcr0 & 0x6) == 0x6 && (regs[1] & (1 << 5)) ) {
+        return simd_avx2;
+    }
+
+    return simd_sse2;
+#elif defined(__DTF_AVX)
+    // checks the OS support of the registers as well
+    __builtin_cpu_init();
+    if ( __builtin_cpu_supports("avx512bw") && __builtin_cpu_supports("avx512f") ) {
+        return simd_avx512;
+    }
+    if ( __builtin_cpu_supports("avx2") ) {
+        return simd_avx2;
+    }
+
+    return simd_sse2;
+#elif defined(__DTF_SSE2)
+    return simd_sse2;
+#else
+    return simd_scalar;
+#endif // __DTF_AVX
+}
+
+// the detected one, or the lower one given by `DTF_SIMD`
+inline simd_level select_simd_level() {
+    const simd_level detected = detect_simd_level();
+#ifdef _MSC_VER
+#   pragma warning(push)
+#   pragma warning(disable: 4996) // getenv
+#endif // _MSC_VER
+    const char *env = std::getenv("DTF_SIMD");
+#ifdef _MSC_VER
+#   pragma warning(pop)
+#endif // _MSC_VER
+    if ( !env ) {
+        return detected;
+    }
+    for ( std::uint32_t level = simd_scalar; level <= detected; ++level ) {
+        if ( std::strcmp(env, simd_level_name(static_cast<simd_level>(level))) == 0 ) {
+            return static_cast<simd_level>(level);
+        }
+    }
+
+    return detected;
+}
+
+__DTF_LIBRARY_INLINE simd_level get_simd_level() {
+    static const simd_level level = select_simd_level();
+
+    return level;
+}
+#endif // __DTF_LIBRARY_DEFINITIONS
+
+// scans the blocks of `Width` bytes while the kernel can read `Width + 8` bytes,
+// `*pos` is the start of the unscanned bytes. returns true when the date-time is found at `*pos`.
+template<std::size_t Width, typename Mask, Mask (*Candidates)(const char *)>
+bool find_dt_blocks(std::size_t *pos, const char *buf, std::size_t n, std::size_t *len, std::uint32_t *flags) {
+    // the candidates are confirmed by the layout of the date and by `get_flags_prefix()`
+    std::size_t i = *pos;
+    for ( ; i + Width + 8 <= n; i += Width ) {
+        for ( Mask mask = Candidates(buf + i); mask; mask &= mask - 1 ) {
+            const std::size_t at = i + count_trailing_zeros(mask);
+            if ( n - at >= 15 && is_dt_date(buf + at)
+                && get_flags_prefix(flags, len, buf + at, n - at) == error::ok )
+            {
+                *pos = at;
+                return true;
+            }
+        }
+    }
+    *pos = i;
+
+    return false;
+}
+
+// `find_dt()` using the given kernel, which must be supported. the wider kernel scans
+// the most of the text, the narrower ones scan the rest.
+inline std::size_t find_dt_with(simd_level level, const char *buf, std::size_t n, std::size_t *len, std::uint32_t *flags) {
+    std::size_t i = 0;
+#ifdef __DTF_AVX
+    if ( level >= simd_avx512 && find_dt_blocks<64, std::uint64_t, find_dt_candidates_avx512>(&i, buf, n, len, flags) ) {
+        return i;
+    }
+    if ( level >= simd_avx2 && find_dt_blocks<32, std::uint32_t, find_dt_candidates_avx2>(&i, buf, n, len, flags) ) {
+        return i;
+    }
+#endif // __DTF_AVX
+#ifdef __DTF_SSE2
+    if ( level >= simd_sse2 && find_dt_blocks<16, std::uint32_t, find_dt_candidates>(&i, buf, n, len, flags) ) {
+        return i;
+    }
+#else
+    (void)level;
+#endif // __DTF_SSE2
+
+    for ( ; i + 15 <= n; ++i ) {
+        if ( is_dt_date(buf + i) && get_flags_prefix(flags, len, buf + i, n - i) == error::ok ) {
+            return i;
+        }
+    }
+
+    *len = 0;
+    *flags = 0;
+
+    return n;
+}
+
+#if __DTF_LIBRARY_DEFINITIONS
+__DTF_LIBRARY_INLINE std::size_t find_dt(const char *buf, std::size_t n, std::size_t *len, std::uint32_t *flags) {
+    return find_dt_with(get_simd_level(), buf, n, len, flags);
+}
+#endif // __DTF_LIBRARY_DEFINITIONS
+
+#if __cplusplus >= 201703L
+
+inline error get_flags(std::uint32_t *flags, std::string_view str) {
+    return get_flags(flags, str.data(), str.length());
+}
+
+inline error get_flags_prefix(std::uint32_t *flags, std::size_t *consumed, std::string_view str) {
+    return get_flags_prefix(flags, consumed, str.data(), str.length());
+}
+
+#else
+
+inline error get_flags(std::uint32_t *flags, const std::string &str) {
+    return get_flags(flags, str.c_str(), str.length());
+}
+
+inline error get_flags_prefix(std::uint32_t *flags, std::size_t *consumed, const std::string &str) {
+    return get_flags_prefix(flags, consumed, str.c_str(), str.length());
+}
+
+#endif // __cplusplus >= 201703L
+
+/*************************************************************************************************/
+
+#if __DTF_LIBRARY_DEFINITIONS
+__DTF_LIBRARY_INLINE error from_dt_chars(std::uint64_t *ts, const char *buf, std::size_t len, std::uint32_t f) {
+    *ts = 0;
+
+    // all the fields are of the fixed width, so nothing is read out of the string
+    if ( len != dt_chars_size(f) ) {
+        return error::dt_mismatch;
+    }
+
+    const bool with_datesep = !(f & flags::date_sep_empty);
+    const char datesep = (f & flags::date_sep_dash) ? '-' : '.';
+    const bool with_timesep = !(f & flags::time_sep_empty);
+    const char timesep = (f & flags::time_sep_colon) ? ':' : '.';
+    const char dtsep = (f & flags::dt_sep_T)
+        ? 'T'
+        : (f & flags::dt_sep_t)
+            ? 't'
+            : (f & flags::dt_sep_space)
+                ? ' '
+                : (f & flags::dt_sep_underscore)
+                    ? '_'
+                    : (f & flags::dt_sep_slash)
+                        ? '/'
+                        : '-'
+    ;
+
+    std::uint32_t year = 0, month = 0, day = 0, hours = 0, mins = 0, secs = 0, frac = 0;
+    std::int32_t zone_secs = 0;
+
+    const char *p = buf;
+    bool ok = true;
+    if ( f & flags::yyyy_mm_dd ) {
+        ok = parse_digits(&year, p, 4) && ok; p += 4;
+        if ( with_datesep ) { ok = *p++ == datesep && ok; }
+        ok = parse_digits(&month, p, 2) && ok; p += 2;
+        if ( with_datesep ) { ok = *p++ == datesep && ok; }
+        ok = parse_digits(&day, p, 2) && ok; p += 2;
+    } else {
+        ok = parse_digits(&day, p, 2) && ok; p += 2;
+        if ( with_datesep ) { ok = *p++ == datesep && ok; }
+        ok = parse_digits(&month, p, 2) && ok; p += 2;
+        if ( with_datesep ) { ok = *p++ == datesep && ok; }
+        ok = parse_digits(&year, p, 4) && ok; p += 4;
+    }
+
+    ok = *p++ == dtsep && ok;
+
+    ok = parse_digits(&hours, p, 2) && ok; p += 2;
+    if ( with_timesep ) { ok = *p++ == timesep && ok; }
+    ok = parse_digits(&mins, p, 2) && ok; p += 2;
+    if ( with_timesep ) { ok = *p++ == timesep && ok; }
+    ok = parse_digits(&secs, p, 2) && ok; p += 2;
+
+    const std::uint32_t frac_width = (f & flags::msecs) ? 3 : (f & flags::usecs) ? 6 : (f & flags::nsecs) ? 9 : 0;
+    if ( frac_width ) {
+        ok = *p++ == '.' && ok;
+        ok = parse_digits(&frac, p, frac_width) && ok;
+        frac *= luts<>::pow10_lut[9 - frac_width];
+        p += frac_width;
+    }
+
+    if ( f & flags::zone_Z ) {
+        ok = *p++ == 'Z' && ok;
+    } else if ( f & flags::zone_offset ) {
+        ok = __DTF_IS_ZONE_OFFSET_VALID(p) && ok;
+        if ( ok ) {
+            const std::uint32_t hh = static_cast<std::uint32_t>((p[1] - '0') * 10 + (p[2] - '0'));
+            const std::uint32_t mm = static_cast<std::uint32_t>((p[4] - '0') * 10 + (p[5] - '0'));
+            if ( hh >= __DTF_HOURS_PER_DAY || mm >= __DTF_MINS_PER_HOUR ) {
+                return error::wrong_zone_offset;
+            }
+            zone_secs = static_cast<std::int32_t>(hh * __DTF_SECS_PER_HOUR + mm * __DTF_SECS_PER_MIN);
+            zone_secs = p[0] == '-' ? -zone_secs : zone_secs;
+        }
+        p += 6;
+    }
+    assert(p == buf + len);
+
+    if ( !ok ) {
+        return error::dt_mismatch;
+    }
+
+    // the leap second is accepted as in `pattern::parse()`
+    if ( month < 1 || month > 12 || day < 1 || day > days_in_month(year, month)
+        || hours > 23 || mins > 59 || secs > 60 )
+    {
+        return error::wrong_dt_value;
+    }
+
+    const std::int64_t res = days_from_civil(year, month, day) * __DTF_SECS_PER_DAY
+        + hours * __DTF_SECS_PER_HOUR
+        + mins * __DTF_SECS_PER_MIN
+        + secs
+        - zone_secs
+    ;
+    if ( res < 0 || static_cast<std::uint64_t>(res) > (~0ull - frac) / __DTF_NSECS_PER_SEC ) {
+        return error::wrong_dt_value;
     }
+    *ts = static_cast<std::uint64_t>(res) * __DTF_NSECS_PER_SEC + frac;
 
     return error::ok;
 }
+#endif // __DTF_LIBRARY_DEFINITIONS
 
-inline error get_flags(std::uint32_t *flags, const std::string &str) {
-    return get_flags(flags, str.c_str(), str.length());
+#if __cplusplus >= 201703L
+
+inline error from_dt_chars(std::uint64_t *ts, std::string_view str, std::uint32_t f) {
+    return from_dt_chars(ts, str.data(), str.length(), f);
+}
+
+#else
+
+inline error from_dt_chars(std::uint64_t *ts, const std::string &str, std::uint32_t f) {
+    return from_dt_chars(ts, str.c_str(), str.length(), f);
 }
 
+#endif // __cplusplus >= 201703L
+
 /*************************************************************************************************/
 
 inline std::ostream& dump_flags(std::ostream &os, std::uint32_t flags, bool with_dtf_prefix) {
@@ -739,6 +3320,8 @@ inline std::ostream& dump_flags(std::ostream &os, std::uint32_t flags, bool with
         ,"msecs"
         ,"usecs"
         ,"nsecs"
+        ,"zone_Z"
+        ,"zone_offset"
     };
 
     for ( auto idx = 0u; flags; ++idx ) {
@@ -759,6 +3342,658 @@ inline std::ostream& dump_flags(std::ostream &os, std::uint32_t flags, bool with
     return os;
 }
 
+#ifdef DTF_ENABLE_CACHE_STATS
+
+inline std::ostream& dump_cache_stats(std::ostream &os, const cache_stats &stats) {
+    os << "hits=" << stats.hits << ", misses=" << stats.misses << ", new_days=" << stats.new_days;
+    for ( std::size_t i = 0; i < stats.num_flag_sets; ++i ) {
+        os << "\n[";
+        dump_flags(os, stats.flag_sets[i].flags) << "]=" << stats.flag_sets[i].calls;
+    }
+    if ( stats.other_flag_sets_calls ) {
+        os << "\n[other]=" << stats.other_flag_sets_calls;
+    }
+
+    return os;
+}
+
+#endif // DTF_ENABLE_CACHE_STATS
+
+/*************************************************************************************************/
+
+template<typename T> const char luts<T>::month_abbrs[37] = "JanFebMarAprMayJunJulAugSepOctNovDec";
+template<typename T> const char luts<T>::wday_abbrs[22] = "SunMonTueWedThuFriSat";
+
+// the names are padded to the same width to be copied by the single `memcpy()`
+template<typename T> const char luts<T>::month_names[12][10] = {
+     "January", "February", "March", "April", "May", "June"
+    ,"July", "August", "September", "October", "November", "December"
+};
+template<typename T> const std::uint8_t luts<T>::month_name_lens[12] = {7, 8, 5, 5, 3, 4, 4, 6, 9, 7, 8, 8};
+
+template<typename T> const char luts<T>::wday_names[7][10] = {
+    "Sunday", "Monday", "Tuesday", "Wednesday", "Thursday", "Friday", "Saturday"
+};
+template<typename T> const std::uint8_t luts<T>::wday_name_lens[7] = {6, 6, 7, 9, 8, 6, 8};
+
+/*************************************************************************************************/
+
+inline pattern::pattern(const char *fmt) {
+    const auto err = compile(fmt);
+    assert(err == error::ok && "the pattern is invalid!");
+    (void)err;
+}
+
+inline error pattern::compile(const char *fmt) {
+    // the unique id of compiled pattern, is used as the key for the rendered strings cache
+    static std::atomic<std::uint64_t> ids{0};
+
+    m_id = ++ids;
+    m_num_ops = 0;
+    m_num_lits = 0;
+    m_max_size = 0;
+    m_codes = 0;
+
+    const auto err = compile_impl(fmt);
+    if ( err != error::ok ) {
+        m_num_ops = 0;
+        m_num_lits = 0;
+        m_max_size = 0;
+        m_codes = 0;
+    }
+
+    return err;
+}
+
+inline error pattern::add_op(std::uint32_t code, std::uint32_t len, std::uint32_t width) {
+    if ( m_num_ops == max_ops ) {
+        return error::pattern_too_long;
+    }
+
+    m_ops[m_num_ops++] = {
+         static_cast<std::uint8_t>(code)
+        ,static_cast<std::uint8_t>(len)
+        ,0
+    };
+    m_max_size += width;
+    m_codes |= 1u << code;
+
+    return error::ok;
+}
+
+inline error pattern::add_literal(const char *str, std::uint32_t len) {
+    if ( m_num_lits + len > max_literals ) {
+        return error::pattern_too_long;
+    }
+
+    // the adjacent literals are merged into the single op
+    op *last = m_num_ops ? &m_ops[m_num_ops - 1] : nullptr;
+    if ( last && last->code == op_literal && last->arg + last->len == m_num_lits ) {
+        last->len = static_cast<std::uint8_t>(last->len + len);
+    } else {
+        if ( m_num_ops == max_ops ) {
+            return error::pattern_too_long;
+        }
+        m_ops[m_num_ops++] = {
+             op_literal
+            ,static_cast<std::uint8_t>(len)
+            ,static_cast<std::uint16_t>(m_num_lits)
+        };
+    }
+
+    std::memcpy(m_lits + m_num_lits, str, len);
+    m_num_lits += len;
+    m_max_size += len;
+
+    return error::ok;
+}
+
+inline error pattern::compile_impl(const char *fmt) {
+    for ( const char *p = fmt; *p; ++p ) {
+        if ( *p != '%' ) {
+            const auto err = add_literal(p, 1);
+            if ( err != error::ok ) {
+                return err;
+            }
+
+            continue;
+        }
+
+        ++p;
+        std::uint32_t width = 0;
+        if ( *p == '3' || *p == '6' || *p == '9' ) {
+            width = static_cast<std::uint32_t>(*p - '0');
+            ++p;
+            if ( *p != 'N' ) {
+                return error::wrong_pattern_spec;
+            }
+        }
+
+        error err = error::ok;
+        switch ( *p ) {
+            case 'Y': err = add_op(op_year4, 4, 4); break;
+            case 'y': err = add_op(op_year2, 2, 2); break;
+            case 'm': err = add_op(op_month, 2, 2); break;
+            case 'b':
+            case 'h': err = add_op(op_month_abbr, 3, 3); break;
+            case 'B': err = add_op(op_month_name, 3, 9); break;
+            case 'd': err = add_op(op_day, 2, 2); break;
+            case 'e': err = add_op(op_day_space, 2, 2); break;
+            case 'j': err = add_op(op_yday, 3, 3); break;
+            case 'a': err = add_op(op_wday_abbr, 3, 3); break;
+            case 'A': err = add_op(op_wday_name, 3, 9); break;
+            case 'H': err = add_op(op_hours, 2, 2); break;
+            case 'I': err = add_op(op_hours12, 2, 2); break;
+            case 'p': err = add_op(op_ampm, 2, 2); break;
+            case 'M': err = add_op(op_mins, 2, 2); break;
+            case 'S': err = add_op(op_secs, 2, 2); break;
+            case 's': err = add_op(op_epoch, 1, 10); break;
+            case 'N': {
+                width = width ? width : 9;
+                err = add_op(op_fraction, width, width);
+                break;
+            }
+            case 'F': err = compile_impl("%Y-%m-%d"); break;
+            case 'T': err = compile_impl("%H:%M:%S"); break;
+            case 'R': err = compile_impl("%H:%M"); break;
+            case 'D': err = compile_impl("%m/%d/%y"); break;
+            case 'z': err = add_op(op_zone, 5, 5); break;
+            case 'Z': err = add_literal("GMT", 3); break;
+            case 'n': err = add_literal("\n", 1); break;
+            case 't': err = add_literal("\t", 1); break;
+            case '%': err = add_literal("%", 1); break;
+            default: return error::wrong_pattern_spec;
+        }
+
+        if ( err != error::ok ) {
+            return err;
+        }
+    }
+
+    return error::ok;
+}
+
+inline std::size_t pattern::format(char *ptr, std::uint64_t ts) const {
+    const std::uint32_t ss = ts / __DTF_NSECS_PER_SEC;
+    const std::uint32_t ps = ts % __DTF_NSECS_PER_SEC;
+
+    static thread_local rendered cached{};
+    if ( cached.id != m_id || cached.ss != ss ) {
+        cached.len = static_cast<std::uint32_t>(render(&cached, ss));
+        cached.id = m_id;
+        cached.ss = ss;
+    }
+
+    copy_short(ptr, cached.buf, cached.len);
+    for ( std::uint32_t idx = 0; idx < cached.num_fractions; ++idx ) {
+        const op &it = cached.fractions[idx];
+        utoa_fixed(ptr + it.arg, it.len, ps / luts<>::pow10_lut[9 - it.len]);
+    }
+
+    return cached.len;
+}
+
+inline std::size_t pattern::render(rendered *r, std::uint32_t ss) const {
+    const civil_time &ct = cached_civil(ss);
+
+    r->num_fractions = 0;
+    char *ptr = r->buf;
+    char *p = ptr;
+    for ( const op *it = m_ops, *end = m_ops + m_num_ops; it != end; ++it ) {
+        switch ( it->code ) {
+            case op_literal: {
+                copy_short(p, m_lits + it->arg, it->len);
+                p += it->len;
+                break;
+            }
+            case op_year4: { __DTF_YEAR(p, ct.year); break; }
+            case op_year2: { __DTF_DHMS(p, ct.year % 100); break; }
+            case op_month: { __DTF_MONTH(p, ct.month); break; }
+            case op_month_abbr: {
+                std::memcpy(p, luts<>::month_abbrs + ct.month * 3, 3);
+                p += 3;
+                break;
+            }
+            case op_month_name: {
+                std::memcpy(p, luts<>::month_names[ct.month], 9);
+                p += luts<>::month_name_lens[ct.month];
+                break;
+            }
+            case op_day: { __DTF_DHMS(p, ct.day); break; }
+            case op_day_space: {
+                p[0] = ct.day < 10 ? ' ' : luts<>::digits_lut[ct.day * 2];
+                p[1] = luts<>::digits_lut[ct.day * 2 + 1];
+                p += 2;
+                break;
+            }
+            case op_yday: {
+                utoa_fixed(p, 3, ct.yday + 1);
+                p += 3;
+                break;
+            }
+            case op_wday_abbr: {
+                std::memcpy(p, luts<>::wday_abbrs + ct.wday * 3, 3);
+                p += 3;
+                break;
+            }
+            case op_wday_name: {
+                std::memcpy(p, luts<>::wday_names[ct.wday], 9);
+                p += luts<>::wday_name_lens[ct.wday];
+                break;
+            }
+            case op_hours: { __DTF_DHMS(p, ct.hours); break; }
+            case op_hours12: {
+                const std::uint32_t h = ct.hours % 12;
+                __DTF_DHMS(p, h ? h : 12);
+                break;
+            }
+            case op_ampm: {
+                std::memcpy(p, ct.hours < 12 ? "AM" : "PM", 2);
+                p += 2;
+                break;
+            }
+            case op_mins: { __DTF_DHMS(p, ct.mins); break; }
+            case op_secs: { __DTF_DHMS(p, ct.secs); break; }
+            case op_epoch: {
+                const auto n = num_chars(ss);
+                utoa(p, n, ss);
+                p += n;
+                break;
+            }
+            case op_zone: {
+                std::memcpy(p, "+0000", 5);
+                p += 5;
+                break;
+            }
+            case op_fraction: {
+                // will be written on each call
+                r->fractions[r->num_fractions++] = {
+                     op_fraction
+                    ,it->len
+                    ,static_cast<std::uint16_t>(p - ptr)
+                };
+                p += it->len;
+                break;
+            }
+        }
+    }
+
+    return static_cast<std::size_t>(p - ptr);
+}
+
+inline std::string pattern::format(std::uint64_t ts) const {
+    std::string res;
+    res.resize(m_max_size);
+
+    const auto n = format(std::addressof(res[0]), ts);
+    res.resize(n);
+
+    return res;
+}
+
+// returns the index of the name in `names` of `num` entries by the first three chars, case insensitive
+inline std::uint32_t find_name_abbr(const char *names, std::uint32_t num, const char *p) {
+    const std::uint32_t key = (static_cast<std::uint32_t>(static_cast<unsigned char>(p[0])) << 16)
+        | (static_cast<std::uint32_t>(static_cast<unsigned char>(p[1])) << 8)
+        | static_cast<std::uint32_t>(static_cast<unsigned char>(p[2]))
+    ;
+    for ( std::uint32_t idx = 0; idx < num; ++idx ) {
+        const char *n = names + idx * 3;
+        const std::uint32_t name = (static_cast<std::uint32_t>(n[0]) << 16)
+            | (static_cast<std::uint32_t>(n[1]) << 8)
+            | static_cast<std::uint32_t>(n[2])
+        ;
+        if ( (key | 0x202020u) == (name | 0x202020u) ) {
+            return idx;
+        }
+    }
+
+    return num;
+}
+
+// returns the num of chars of the rest of the full name matched, case insensitive
+inline std::size_t match_name_tail(const char *name, std::size_t name_len, const char *p, std::size_t len) {
+    if ( len < name_len - 3 ) {
+        return 0;
+    }
+    for ( std::size_t idx = 3; idx < name_len; ++idx ) {
+        if ( (p[idx - 3] | 0x20) != (name[idx] | 0x20) ) {
+            return 0;
+        }
+    }
+
+    return name_len - 3;
+}
+
+inline error pattern::parse(std::uint64_t *ts, const char *buf, std::size_t len, std::uint64_t ref_ts) const {
+    *ts = 0;
+
+    std::uint32_t year = 1970, month = 1, day = 1, yday = 0;
+    std::uint32_t hours = 0, mins = 0, secs = 0, frac = 0;
+    std::uint64_t epoch = 0;
+    std::int32_t zone_secs = 0;
+    bool pm = false;
+
+    const char *p = buf;
+    const char *end = buf + len;
+    for ( const op *it = m_ops, *opsend = m_ops + m_num_ops; it != opsend; ++it ) {
+        // `it->len` is the exact width for all the ops except `%B`, `%A` and `%s`
+        if ( static_cast<std::size_t>(end - p) < it->len ) {
+            return error::pattern_mismatch;
+        }
+
+        bool ok = true;
+        switch ( it->code ) {
+            case op_literal: {
+                ok = std::memcmp(p, m_lits + it->arg, it->len) == 0;
+                p += it->len;
+                break;
+            }
+            case op_year4: { ok = parse_digits(&year, p, 4); p += 4; break; }
+            case op_year2: {
+                ok = parse_digits(&year, p, 2);
+                // the POSIX rule: [69-99] -> 19xx, [00-68] -> 20xx
+                year += year < 69 ? 2000 : 1900;
+                p += 2;
+                break;
+            }
+            case op_month: { ok = parse_digits(&month, p, 2); p += 2; break; }
+            case op_month_abbr:
+            case op_month_name: {
+                const std::uint32_t idx = find_name_abbr(luts<>::month_abbrs, 12, p);
+                ok = idx != 12;
+                if ( ok ) {
+                    month = idx + 1;
+                    p += 3;
+                    if ( it->code == op_month_name ) {
+                        p += match_name_tail(luts<>::month_names[idx], luts<>::month_name_lens[idx], p, end - p);
+                    }
+                }
+                break;
+            }
+            case op_day: { ok = parse_digits(&day, p, 2); p += 2; break; }
+            case op_day_space: {
+                ok = p[0] == ' ' ? parse_digits(&day, p + 1, 1) : parse_digits(&day, p, 2);
+                p += 2;
+                break;
+            }
+            case op_yday: { ok = parse_digits(&yday, p, 3); p += 3; break; }
+            case op_wday_abbr:
+            case op_wday_name: {
+                const std::uint32_t idx = find_name_abbr(luts<>::wday_abbrs, 7, p);
+                ok = idx != 7;
+                if ( ok ) {
+                    p += 3;
+                    if ( it->code == op_wday_name ) {
+                        p += match_name_tail(luts<>::wday_names[idx], luts<>::wday_name_lens[idx], p, end - p);
+                    }
+                }
+                break;
+            }
+            case op_hours:
+            case op_hours12: { ok = parse_digits(&hours, p, 2); p += 2; break; }
+            case op_ampm: {
+                const char ch0 = static_cast<char>(p[0] | 0x20);
+                ok = (ch0 == 'a' || ch0 == 'p') && (p[1] | 0x20) == 'm';
+                pm = ch0 == 'p';
+                p += 2;
+                break;
+            }
+            case op_mins: { ok = parse_digits(&mins, p, 2); p += 2; break; }
+            case op_secs: { ok = parse_digits(&secs, p, 2); p += 2; break; }
+            case op_epoch: {
+                const char *beg = p;
+                for ( ; p != end && p - beg < 11 && static_cast<unsigned char>(*p - '0') <= 9; ++p ) {
+                    epoch = epoch * 10 + static_cast<std::uint64_t>(*p - '0');
+                }
+                ok = p != beg;
+                break;
+            }
+            case op_fraction: {
+                ok = parse_digits(&frac, p, it->len);
+                frac *= luts<>::pow10_lut[9 - it->len];
+                p += it->len;
+                break;
+            }
+            case op_zone: {
+                std::uint32_t hh = 0, mm = 0;
+                ok = (p[0] == '+' || p[0] == '-')
+                    && parse_digits(&hh, p + 1, 2)
+                    && parse_digits(&mm, p + 3, 2)
+                ;
+                ok = ok && hh < 24 && mm < 60;
+                zone_secs = static_cast<std::int32_t>(hh * __DTF_SECS_PER_HOUR + mm * __DTF_SECS_PER_MIN);
+                zone_secs = p[0] == '-' ? -zone_secs : zone_secs;
+                p += 5;
+                break;
+            }
+        }
+
+        if ( !ok ) {
+            return error::pattern_mismatch;
+        }
+    }
+
+    if ( p != end ) {
+        return error::pattern_mismatch;
+    }
+
+    if ( m_codes & (1u << op_epoch) ) {
+        if ( epoch > (~0ull - frac) / __DTF_NSECS_PER_SEC ) {
+            return error::wrong_pattern_value;
+        }
+        *ts = epoch * __DTF_NSECS_PER_SEC + frac;
+
+        return error::ok;
+    }
+
+    if ( m_codes & (1u << op_hours12) ) {
+        if ( hours < 1 || hours > 12 ) {
+            return error::wrong_pattern_value;
+        }
+        hours = (hours % 12) + (pm ? 12 : 0);
+    }
+
+    const std::uint32_t date_codes = (1u << op_month) | (1u << op_month_abbr)
+        | (1u << op_month_name) | (1u << op_day) | (1u << op_day_space)
+    ;
+    const bool has_yday = (m_codes & (1u << op_yday)) && !(m_codes & date_codes);
+    const bool has_year = m_codes & ((1u << op_year4) | (1u << op_year2));
+    if ( !has_year ) {
+        const std::uint64_t ref = ref_ts ? ref_ts : timestamp();
+        const civil_time &ct = cached_civil(static_cast<std::uint32_t>(ref / __DTF_NSECS_PER_SEC));
+        year = ct.year;
+        if ( !has_yday && !(m_codes & date_codes) ) {
+            // the time only
+            month = ct.month + 1;
+            day = ct.day;
+        } else if ( !has_yday && month > ct.month + 2 ) {
+            // the date in the future is from the previous year
+            --year;
+        }
+    }
+
+    if ( month < 1 || month > 12 || hours > 23 || mins > 59 || secs > 60 ) {
+        return error::wrong_pattern_value;
+    }
+
+    std::int64_t days;
+    if ( has_yday ) {
+        if ( yday < 1 || yday > 365u + is_leap_year(year) ) {
+            return error::wrong_pattern_value;
+        }
+        days = days_from_civil(year, 1, 1) + yday - 1;
+    } else {
+        if ( day < 1 || day > days_in_month(year, month) ) {
+            return error::wrong_pattern_value;
+        }
+        days = days_from_civil(year, month, day);
+    }
+
+    const std::int64_t res = days * __DTF_SECS_PER_DAY
+        + hours * __DTF_SECS_PER_HOUR
+        + mins * __DTF_SECS_PER_MIN
+        + secs
+        - zone_secs
+    ;
+    if ( res < 0 || static_cast<std::uint64_t>(res) > (~0ull - frac) / __DTF_NSECS_PER_SEC ) {
+        return error::wrong_pattern_value;
+    }
+    *ts = static_cast<std::uint64_t>(res) * __DTF_NSECS_PER_SEC + frac;
+
+    return error::ok;
+}
+
+inline error pattern::parse(std::uint64_t *ts, const std::string &str, std::uint64_t ref_ts) const {
+    return parse(ts, str.c_str(), str.length(), ref_ts);
+}
+
+/*************************************************************************************************/
+
+inline std::size_t to_http_date_chars(char *ptr, std::uint64_t ts) {
+    const civil_time &ct = cached_civil(static_cast<std::uint32_t>(ts / __DTF_NSECS_PER_SEC));
+
+    char *p = ptr;
+    std::memcpy(p, luts<>::wday_abbrs + ct.wday * 3, 3); p += 3;
+    std::memcpy(p, ", ", 2); p += 2;
+    __DTF_DHMS(p, ct.day);
+    *p++ = ' ';
+    std::memcpy(p, luts<>::month_abbrs + ct.month * 3, 3); p += 3;
+    *p++ = ' ';
+    __DTF_YEAR(p, ct.year);
+    *p++ = ' ';
+    __DTF_DHMS(p, ct.hours);
+    *p++ = ':';
+    __DTF_DHMS(p, ct.mins);
+    *p++ = ':';
+    __DTF_DHMS(p, ct.secs);
+    std::memcpy(p, " GMT", 4); p += 4;
+
+    assert(p - ptr == http_date_size);
+
+    return http_date_size;
+}
+
+inline std::size_t to_http_date_chars(char *ptr, std::uint64_t ts, http_date_cache &cache) {
+    const std::uint64_t ss = ts / __DTF_NSECS_PER_SEC;
+
+    std::uint64_t words[4];
+    const std::uint64_t seq = cache.m_seq.load(std::memory_order_acquire);
+    if ( !(seq & 1u) && cache.m_ss.load(std::memory_order_relaxed) == ss ) {
+        for ( auto idx = 0u; idx < 4; ++idx ) {
+            words[idx] = cache.m_words[idx].load(std::memory_order_relaxed);
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if ( cache.m_seq.load(std::memory_order_relaxed) == seq ) {
+            std::memcpy(ptr, words, http_date_size);
+
+            return http_date_size;
+        }
+    }
+
+    to_http_date_chars(ptr, ts);
+
+    // publish, if nobody else does it now
+    std::uint64_t expected = cache.m_seq.load(std::memory_order_relaxed);
+    if ( !(expected & 1u)
+        && cache.m_seq.compare_exchange_strong(expected, expected + 1, std::memory_order_relaxed) )
+    {
+        std::atomic_thread_fence(std::memory_order_release);
+        words[3] = 0;
+        std::memcpy(words, ptr, http_date_size);
+        cache.m_ss.store(ss, std::memory_order_relaxed);
+        for ( auto idx = 0u; idx < 4; ++idx ) {
+            cache.m_words[idx].store(words[idx], std::memory_order_relaxed);
+        }
+        cache.m_seq.store(expected + 2, std::memory_order_release);
+    }
+
+    return http_date_size;
+}
+
+inline std::string to_http_date_str(std::uint64_t ts) {
+    std::string res;
+    res.resize(http_date_size);
+
+    to_http_date_chars(std::addressof(res[0]), ts);
+
+    return res;
+}
+
+/*************************************************************************************************/
+
+inline std::uint64_t wall_mapper::steady_now() {
+    return static_cast<std::uint64_t>(
+        std::chrono::duration_cast<
+            std::chrono::nanoseconds
+        >(std::chrono::steady_clock::now().time_since_epoch()).count()
+    );
+}
+
+inline std::uint64_t wall_mapper::wall_now() {
+    return timestamp();
+}
+
+inline wall_mapper::wall_mapper(clock_func mono, clock_func wall, std::uint32_t max_slew_ppm)
+    :m_mono{mono}
+    ,m_wall{wall}
+    ,m_max_slew_ppm{max_slew_ppm}
+{
+    resample();
+}
+
+inline std::int64_t wall_mapper::resample() {
+    // the wall clock is read between two readings of the monotonic one,
+    // the narrowest of a few windows is used (the thread may be preempted)
+    std::uint64_t offset = 0, mono = 0, window = ~0ull;
+    for ( auto idx = 0u; idx < 3u; ++idx ) {
+        const std::uint64_t m0 = m_mono();
+        const std::uint64_t w = m_wall();
+        const std::uint64_t m1 = m_mono();
+        if ( m1 - m0 < window ) {
+            window = m1 - m0;
+            mono = m0 + window / 2;
+            offset = w - mono;
+        }
+    }
+
+    const std::uint64_t prev = m_offset.load(std::memory_order_relaxed);
+    const std::uint64_t seq = m_seq.load(std::memory_order_relaxed);
+    m_seq.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    m_offset.store(offset, std::memory_order_relaxed);
+    m_sample_mono.store(mono, std::memory_order_relaxed);
+    m_sample_error.store(window / 2 + window % 2, std::memory_order_relaxed);
+    m_seq.store(seq + 2, std::memory_order_release);
+
+    return static_cast<std::int64_t>(offset - prev);
+}
+
+inline void wall_mapper::to_wall(std::uint64_t *dst, const std::uint64_t *src, std::size_t n) const {
+    const std::uint64_t offset = m_offset.load(std::memory_order_relaxed);
+    for ( std::size_t i = 0; i < n; ++i ) {
+        dst[i] = src[i] + offset;
+    }
+}
+
+inline std::uint64_t wall_mapper::max_error(std::uint64_t mono) const {
+    std::uint64_t seq, sample_mono, sample_error;
+    do {
+        seq = m_seq.load(std::memory_order_acquire);
+        sample_mono = m_sample_mono.load(std::memory_order_relaxed);
+        sample_error = m_sample_error.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+    } while ( (seq & 1u) || m_seq.load(std::memory_order_relaxed) != seq );
+
+    const std::uint64_t elapsed = mono > sample_mono ? mono - sample_mono : sample_mono - mono;
+    // rounded up, without the overflow
+    const std::uint64_t slew = (elapsed / 1000000u) * m_max_slew_ppm
+        + ((elapsed % 1000000u) * m_max_slew_ppm + 999999u) / 1000000u
+    ;
+
+    return sample_error + slew;
+}
+
 /*************************************************************************************************/
 
 #undef __DTF_FALLTHROUGH
@@ -771,7 +4006,6 @@ inline std::ostream& dump_flags(std::ostream &os, std::uint32_t flags, bool with
 #undef __DTF_DAYS_PER_WEEK
 #undef __DTF_MONS_PER_YEAR
 #undef __DTF_EPOCH_ADJUSTMENT_DAYS
-#undef __DTF_ADJUSTED_EPOCH_YEAR
 #undef __DTF_DAYS_PER_ERA
 #undef __DTF_DAYS_PER_4_YEARS
 #undef __DTF_DAYS_PER_YEAR
@@ -803,6 +4037,18 @@ inline std::ostream& dump_flags(std::ostream &os, std::uint32_t flags, bool with
 #undef __DTF_IS_DD_MM_YYYY_NOSEP_VALID
 #undef __DTF_IS_TIME_SEP_VALID
 #undef __DTF_IS_TIME_NOSEP_VALID
+#undef __DTF_IS_ZONE_SIGN
+#undef __DTF_IS_ZONE_OFFSET_VALID
+#undef __DTF_WEEK_SHIFT_NS
+#undef __DTF_NSECS_PER_DAY
+#undef __DTF_SWAR_DIGITS
+#undef __DTF_BASE36_6
+#undef __DTF_SSE2
+#undef __DTF_AVX
+#undef __DTF_NOINLINE
+#undef __DTF_LIBRARY_DEFINITIONS
+#undef __DTF_LIBRARY_INLINE
+#undef __DTF_FIRST_MONDAY_NS
 
 } // ns dtf
 
@@ -0,0 +1,34 @@
+// MIT License
+//
+// Copyright (c) 2019-2025 niXman (github dot nixman at pm dot me)
+// All rights reserved.
+//
+// This file is part of DTF(https://github.com/niXman/dtf) project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+// the hot functions of `dtf.hpp` compiled once, for the users defining `DTF_LIBRARY`.
+// the users must be compiled with the same `DTF_*` configuration macros.
+
+#ifndef DTF_LIBRARY
+#   error "DTF_LIBRARY must be defined"
+#endif
+
+#define __DTF_LIBRARY_SOURCE
+#include <dtf/dtf.hpp>
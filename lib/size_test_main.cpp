@@ -0,0 +1,80 @@
+// MIT License
+//
+// Copyright (c) 2019-2025 niXman (github dot nixman at pm dot me)
+// All rights reserved.
+//
+// This file is part of DTF(https://github.com/niXman/dtf) project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+// the multi-TU program to compare the header-only usage and the `dtf` library:
+// the sizes of `dtf-size-header` and `dtf-size-library`, and the time of the calls.
+
+#include <dtf/dtf.hpp>
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+
+using tu_func = std::size_t (*)(char *buf, std::uint64_t ts);
+
+static std::vector<tu_func>& registry() {
+    static std::vector<tu_func> funcs;
+    return funcs;
+}
+
+bool register_tu(tu_func func) {
+    registry().push_back(func);
+    return true;
+}
+
+int main() {
+    const std::vector<tu_func> &funcs = registry();
+    const std::uint64_t base = dtf::timestamp();
+    constexpr std::size_t N = 1000000;
+
+    // the best of the rounds
+    char buf[dtf::bufsize * 2];
+    std::size_t total = 0;
+    double best = 0;
+    for ( std::size_t round = 0; round < 10; ++round ) {
+        const auto start = std::chrono::steady_clock::now();
+        for ( std::size_t i = 0; i < N; ++i ) {
+            total += funcs[i % funcs.size()](buf, base + i * 1000003ull);
+        }
+        const std::chrono::duration<double, std::nano> ns = std::chrono::steady_clock::now() - start;
+        best = round == 0 ? ns.count() : std::min(best, ns.count());
+    }
+
+    std::cout << std::fixed << std::setprecision(2)
+        << funcs.size() << " TU(s): " << best / N << " ns/call (" << total << " chars)"
+#ifdef DTF_LIBRARY
+        << ", the library"
+#else
+        << ", header-only"
+#endif // DTF_LIBRARY
+        << std::endl
+    ;
+
+    return 0;
+}
@@ -0,0 +1,143 @@
+
+// MIT License
+//
+// Copyright (c) 2019-2025 niXman (github dot nixman at pm dot me)
+// All rights reserved.
+//
+// This file is part of DTF(https://github.com/niXman/dtf) project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+// the counters change the definitions of the inline functions, so they are tested in their own
+// program, the main tests are built in the default configuration
+#define DTF_ENABLE_CACHE_STATS
+
+#include <dtf/dtf.hpp>
+#include <dtf/dispatch.hpp>
+
+#include <iostream>
+#include <sstream>
+#include <thread>
+
+#include <cassert>
+
+#ifdef NDEBUG
+#   error "This file MUST be compiled with NDEBUG undefined!"
+#endif
+
+/*************************************************************************************************/
+
+int main() {
+    static constexpr auto ts = 1546966223006057057ull; // 2019-01-08 16:50:23.006057057
+
+    std::cout << "Testing dtf::cache_stats..." << std::flush;
+    {
+        constexpr auto flags0 = dtf::yyyy_mm_dd | dtf::date_sep_dash | dtf::dt_sep_T | dtf::time_sep_colon | dtf::msecs;
+        constexpr auto flags1 = dtf::dd_mm_yyyy | dtf::date_sep_point | dtf::dt_sep_space | dtf::time_sep_colon | dtf::secs;
+        // the new thread starts with the empty counters
+        const auto worker = [](std::uint32_t flags, std::uint64_t base) {
+            const auto beg = dtf::get_thread_cache_stats();
+            assert(beg.hits == 0 && beg.misses == 0 && beg.num_flag_sets == 0);
+
+            char buf[dtf::bufsize];
+            dtf::to_dt_chars(buf, base, flags);                         // new day
+            dtf::to_dt_chars(buf, base + 1, flags);                     // hit
+            dtf::to_dt_chars(buf, base + 1000000000ull, flags);         // the same day
+            dtf::to_dt_chars(buf, base + 86400ull * 1000000000ull, flags); // new day
+
+            const auto end = dtf::get_thread_cache_stats();
+            assert(end.hits == 1 && end.misses == 3 && end.new_days == 2);
+            assert(end.num_flag_sets == 1 && end.flag_sets[0].flags == flags && end.flag_sets[0].calls == 4);
+        };
+
+        const auto beg = dtf::get_cache_stats();
+        std::thread t0{worker, flags0, ts};
+        std::thread t1{worker, flags1, ts + 1000ull * 86400ull * 1000000000ull};
+        t0.join();
+        t1.join();
+        const auto end = dtf::get_cache_stats();
+
+        // the finished threads are kept in the totals
+        assert(end.hits - beg.hits == 2);
+        assert(end.misses - beg.misses == 6);
+        assert(end.new_days - beg.new_days == 4);
+        const auto calls_of = [](const dtf::cache_stats &stats, std::uint32_t flags) {
+            for ( std::size_t i = 0; i < stats.num_flag_sets; ++i ) {
+                if ( stats.flag_sets[i].flags == flags ) {
+                    return stats.flag_sets[i].calls;
+                }
+            }
+            return std::uint64_t{0};
+        };
+        assert(calls_of(end, flags0) - calls_of(beg, flags0) == 4);
+        assert(calls_of(end, flags1) - calls_of(beg, flags1) == 4);
+
+        // the flag sets which don't fit into the table
+        dtf::cache_stats stats{};
+        for ( std::uint32_t i = 0; i < dtf::cache_stats_flag_sets + 2; ++i ) {
+            dtf::cache_stats one{};
+            one.num_flag_sets = 1;
+            one.flag_sets[0].flags = i + 1;
+            one.flag_sets[0].calls = 10;
+            dtf::merge_cache_stats(&stats, one);
+            dtf::merge_cache_stats(&stats, one);
+        }
+        assert(stats.num_flag_sets == dtf::cache_stats_flag_sets);
+        assert(stats.flag_sets[0].calls == 20);
+        assert(stats.other_flag_sets_calls == 40);
+
+        std::ostringstream os;
+        dtf::dump_cache_stats(os, end);
+        assert(os.str().find("hits=") == 0);
+    }
+    std::cout << "DONE!" << std::endl;
+
+
+    std::cout << "Testing dtf::cache_stats of all the formatting functions..." << std::flush;
+    {
+        constexpr auto flags = dtf::yyyy_mm_dd | dtf::date_sep_dash | dtf::dt_sep_T | dtf::time_sep_colon | dtf::usecs;
+        // every call using the per-thread cache is counted in its flag set
+        std::thread t{[] {
+            char buf[dtf::bufsize];
+            dtf::to_dt_chars(buf, ts, flags);
+            dtf::to_dt_chars_fixed<flags>(buf, ts);
+            dtf::to_dt_chars_dispatch(buf, ts, flags);
+
+            const std::uint64_t column[] = {ts, ts + 1};
+            char data[2 * dtf::bufsize];
+            std::int32_t offsets[3] = {0};
+            dtf::to_dt_column(data, offsets, column, 2, flags);
+
+            // not counted
+            dtf::context ctx;
+            dtf::to_dt_chars(buf, ts, flags, ctx);
+            dtf::to_dt_chars(buf, ts, flags, dtf::no_cache);
+
+            const auto stats = dtf::get_thread_cache_stats();
+            assert(stats.hits + stats.misses == 5);
+            assert(stats.num_flag_sets == 1 && stats.flag_sets[0].flags == flags && stats.flag_sets[0].calls == 5);
+        }};
+        t.join();
+    }
+    std::cout << "DONE!" << std::endl;
+
+    return 0;
+}
+
+/*************************************************************************************************/
@@ -25,12 +25,16 @@
 // SOFTWARE.
 
 #include <dtf/dtf.hpp>
+#include <dtf/dispatch.hpp>
 
+#include <algorithm>
 #include <iostream>
 #include <sstream>
+#include <vector>
 
 #include <cassert>
 #include <cstring>
+#include <ctime>
 
 #ifdef NDEBUG
 #   error "This file MUST be compiled with NDEBUG undefined!"
@@ -144,6 +148,194 @@ int main() {
     std::cout << "DONE!" << std::endl;
 
 
+    std::cout << "Testing dtf::get_flags() with not terminated DT string..." << std::flush;
+    for ( const auto &it: good_vals ) {
+        // followed by the digits, and exactly sized to catch the reads past the end by ASan
+        std::string followed = std::string{it.exp_str, it.exp_len} + "5555";
+        std::uint32_t flags{};
+        assert(dtf::get_flags(&flags, followed.data(), it.exp_len) == dtf::error::ok);
+        assert(flags == it.flags);
+
+        const std::vector<char> exact(it.exp_str, it.exp_str + it.exp_len);
+        for ( std::size_t len = 0; len < exact.size(); ++len ) {
+            dtf::get_flags(&flags, exact.data(), len);
+            std::size_t consumed = 0;
+            dtf::get_flags_prefix(&flags, &consumed, exact.data(), len);
+            assert(consumed <= len);
+        }
+
+        // the date-time at the beginning of the line
+        std::size_t consumed = 0;
+        const std::string line = std::string{it.exp_str, it.exp_len} + " [INFO] message";
+        assert(dtf::get_flags_prefix(&flags, &consumed, line.data(), line.size()) == dtf::error::ok);
+        assert(flags == it.flags && consumed == it.exp_len);
+        assert(dtf::get_flags_prefix(&flags, &consumed, exact.data(), exact.size()) == dtf::error::ok);
+        assert(flags == it.flags && consumed == it.exp_len);
+    }
+    {
+        std::uint32_t flags{};
+        std::size_t consumed = 0;
+        // the malformed suffixes are not consumed
+        const char *malformed[] = {
+             "2018-12-11 13:58:59.1234 msg"
+            ,"2018-12-11 13:58:59.1234567890"
+            ,"2018-12-11 13:58:59.12+05:30"
+            ,"2018-12-11 13:58:59+0X"
+            ,"2018-12-11 13:58:59+0X:00 msg"
+            ,"2018-12-11 13:58:59-05:3a"
+        };
+        for ( const char *it: malformed ) {
+            assert(dtf::get_flags_prefix(&flags, &consumed, std::string{it}) == dtf::error::ok);
+            assert(consumed == 19 && flags == (dtf::yyyy_mm_dd|dtf::date_sep_dash|dtf::dt_sep_space|dtf::time_sep_colon|dtf::secs));
+        }
+        assert(dtf::get_flags_prefix(&flags, &consumed, std::string{"2018-12-11 13:58:59.123+0X:00"}) == dtf::error::ok);
+        assert(consumed == 23 && (flags & dtf::msecs) && !(flags & dtf::zone_offset));
+        assert(dtf::get_flags_prefix(&flags, &consumed, std::string{"2018-12-11 13:58:59+05:30 msg"}) == dtf::error::ok);
+        assert(consumed == 25 && (flags & dtf::zone_offset));
+        assert(dtf::get_flags_prefix(&flags, &consumed, std::string{"2018-12-11 13:58:59Z"}) == dtf::error::ok);
+        assert(consumed == 20 && (flags & dtf::zone_Z));
+        assert(dtf::get_flags_prefix(&flags, &consumed, std::string{"    at handler.cpp:42"}) != dtf::error::ok);
+        assert(consumed == 0);
+        assert(dtf::get_flags_prefix(&flags, &consumed, std::string{"2018-12-11 13:58"}) == dtf::error::too_short);
+    }
+    std::cout << "DONE!" << std::endl;
+
+
+    std::cout << "Testing dtf::get_flags() with dtf::strict..." << std::flush;
+    for ( const auto &it: good_vals ) {
+        std::uint32_t flags{};
+        assert(dtf::get_flags(&flags, it.exp_str, it.exp_len, dtf::strict) == dtf::error::ok);
+        assert(flags == it.flags);
+    }
+    {
+        static const struct {
+            const char *str;
+            dtf::error strict;
+            dtf::error leap_second;
+        } vals[] = {
+             {"2019-13-45T25:61:61", dtf::error::wrong_dt_value, dtf::error::wrong_dt_value}
+            ,{"2019-00-08T16:50:23", dtf::error::wrong_dt_value, dtf::error::wrong_dt_value}
+            ,{"2019-12-08T16:50:23", dtf::error::ok, dtf::error::ok}
+            ,{"2019-01-00T16:50:23", dtf::error::wrong_dt_value, dtf::error::wrong_dt_value}
+            ,{"2019-01-31T16:50:23", dtf::error::ok, dtf::error::ok}
+            ,{"2019-01-32T16:50:23", dtf::error::wrong_dt_value, dtf::error::wrong_dt_value}
+            ,{"2019-04-31T16:50:23", dtf::error::wrong_dt_value, dtf::error::wrong_dt_value}
+            ,{"2019-02-29T16:50:23", dtf::error::wrong_dt_value, dtf::error::wrong_dt_value}
+            ,{"2020-02-29T16:50:23", dtf::error::ok, dtf::error::ok}
+            ,{"1900-02-29T16:50:23", dtf::error::wrong_dt_value, dtf::error::wrong_dt_value}
+            ,{"2000-02-29T16:50:23", dtf::error::ok, dtf::error::ok}
+            ,{"2000-02-30T16:50:23", dtf::error::wrong_dt_value, dtf::error::wrong_dt_value}
+            ,{"2019-01-08T23:59:59", dtf::error::ok, dtf::error::ok}
+            ,{"2019-01-08T24:00:00", dtf::error::wrong_dt_value, dtf::error::wrong_dt_value}
+            ,{"2019-01-08T16:60:23", dtf::error::wrong_dt_value, dtf::error::wrong_dt_value}
+            ,{"2016-12-31T23:59:60", dtf::error::wrong_dt_value, dtf::error::ok}
+            ,{"2016-12-31T23:59:61", dtf::error::wrong_dt_value, dtf::error::wrong_dt_value}
+            ,{"31.04.2019 16:50:23", dtf::error::wrong_dt_value, dtf::error::wrong_dt_value}
+            ,{"29-02-2020_16.50.23", dtf::error::ok, dtf::error::ok}
+            ,{"29022019t165023", dtf::error::wrong_dt_value, dtf::error::wrong_dt_value}
+            ,{"29022020t165023.006", dtf::error::ok, dtf::error::ok}
+            ,{"20191308T165023Z", dtf::error::wrong_dt_value, dtf::error::wrong_dt_value}
+            ,{"20190108 245023", dtf::error::wrong_dt_value, dtf::error::wrong_dt_value}
+            ,{"2019-01-08T16:50:23+23:59", dtf::error::ok, dtf::error::ok}
+            ,{"2019-01-08T16:50:23+24:00", dtf::error::wrong_dt_value, dtf::error::wrong_dt_value}
+            ,{"2019-01-08T16:50:23-05:60", dtf::error::wrong_dt_value, dtf::error::wrong_dt_value}
+            // the structure is checked first
+            ,{"2019-13-45T25:61", dtf::error::too_short, dtf::error::too_short}
+        };
+        for ( const auto &it: vals ) {
+            const std::size_t len = std::strlen(it.str);
+            std::uint32_t flags{}, exp{};
+            std::size_t consumed = 0;
+            // the same flags are detected, the values are not checked
+            const bool structure_ok = dtf::get_flags(&exp, it.str, len) == dtf::error::ok;
+            assert(structure_ok == (it.strict != dtf::error::too_short));
+            assert(dtf::get_flags(&flags, it.str, len, dtf::strict) == it.strict);
+            assert(it.strict != dtf::error::ok || flags == exp);
+            assert(dtf::get_flags(&flags, it.str, len, dtf::strict_leap_second) == it.leap_second);
+            assert(it.leap_second != dtf::error::ok || flags == exp);
+
+            if ( structure_ok ) {
+                const std::string line = std::string{it.str} + " [INFO] message";
+                assert(dtf::get_flags_prefix(&flags, &consumed, line.data(), line.size(), dtf::strict) == it.strict);
+                assert(consumed == (it.strict == dtf::error::ok ? len : 0));
+            }
+        }
+    }
+    std::cout << "DONE!" << std::endl;
+
+
+    std::cout << "Testing dtf::find_dt()..." << std::flush;
+    {
+        // the near misses: the digits and the separators, but no date-time
+        const std::string noise = "[WARN] host=10.0.0.1:51234 id=1234-56-7 v=12.34.5678 n=12345678 x=87654321-a: ";
+        std::size_t len = 1;
+        std::uint32_t flags = 1;
+        assert(dtf::find_dt(noise.data(), noise.size(), &len, &flags) == noise.size());
+        assert(len == 0 && flags == 0);
+        assert(dtf::find_dt(noise.data(), 0, &len, &flags) == 0);
+
+        for ( const auto &it: good_vals ) {
+            // every offset, so both the vectorized part and the tail are involved
+            for ( std::size_t off = 0; off < 40; ++off ) {
+                const std::string text = noise.substr(0, off) + " " + std::string{it.exp_str, it.exp_len} + " [INFO] 12-34 msg";
+                const std::vector<char> exact(text.begin(), text.end());
+                assert(dtf::find_dt(exact.data(), exact.size(), &len, &flags) == off + 1);
+                assert(len == it.exp_len && flags == it.flags);
+
+                // not terminated right after the date-time
+                assert(dtf::find_dt(exact.data(), off + 1 + it.exp_len, &len, &flags) == off + 1);
+                assert(len == it.exp_len && flags == it.flags);
+            }
+        }
+
+        // all the date-times of the text
+        const std::string text = noise
+            + "2018-12-11T13:58:59.123Z a\n"
+            + noise
+            + "11.12.2018 13:58:59 b\n"
+            + "x 20181211T135859 c "
+            + noise
+        ;
+        const char *exp[] = {"2018-12-11T13:58:59.123Z", "11.12.2018 13:58:59", "20181211T135859"};
+        std::size_t num = 0;
+        for ( std::size_t pos = 0; ; ) {
+            const std::size_t found = dtf::find_dt(text.data() + pos, text.size() - pos, &len, &flags);
+            if ( found == text.size() - pos ) {
+                break;
+            }
+            assert(num < 3 && text.compare(pos + found, len, exp[num]) == 0);
+            ++num;
+            pos += found + len;
+        }
+        assert(num == 3);
+    }
+    std::cout << "DONE!" << std::endl;
+
+
+    std::cout << "Testing dtf::find_dt() kernels..." << std::flush;
+    {
+        assert(std::strcmp(dtf::simd_level_name(dtf::get_simd_level()), "unknown") != 0);
+
+        // every kernel supported here gives the same results as the scalar code
+        const std::string noise = "[WARN] host=10.0.0.1:51234 id=1234-56-7 v=12.34.5678 n=12345678 x=87654321-a: ";
+        for ( std::uint32_t level = dtf::simd_scalar; level <= dtf::get_simd_level(); ++level ) {
+            for ( const auto &it: good_vals ) {
+                // the offsets across the 64-byte blocks and their tails
+                for ( std::size_t off = 0; off < 2 * noise.size(); off += 3 ) {
+                    const std::string text = (noise + noise).substr(0, off) + " " + std::string{it.exp_str, it.exp_len} + " msg";
+                    const std::vector<char> exact(text.begin(), text.end());
+                    std::size_t len, exp_len;
+                    std::uint32_t flags, exp_flags;
+                    const std::size_t pos = dtf::find_dt_with(static_cast<dtf::simd_level>(level), exact.data(), exact.size(), &len, &flags);
+                    assert(pos == dtf::find_dt_with(dtf::simd_scalar, exact.data(), exact.size(), &exp_len, &exp_flags));
+                    assert(pos <= off + 1 && len == exp_len && flags == exp_flags);
+                }
+            }
+        }
+    }
+    std::cout << "DONE!" << std::endl;
+
+
     std::cout << "Testing dtf::to_dt_chars()..." << std::flush;
     for ( const auto &it: good_vals ) {
         char buf[dtf::bufsize];
@@ -162,6 +354,870 @@ int main() {
     }
     std::cout << "DONE!" << std::endl;
 
+
+    std::cout << "Testing dtf::from_chars()..." << std::flush;
+    {
+        for ( const std::uint32_t f: {dtf::secs, dtf::msecs, dtf::usecs, dtf::nsecs} ) {
+            const std::uint64_t scale = f == dtf::secs ? 1000000000ull : f == dtf::msecs ? 1000000ull : f == dtf::usecs ? 1000ull : 1ull;
+            for ( std::uint64_t t: {ts, ts / 3, ts / 100000, 1000000000ull, 0ull, 123456789ull} ) {
+                char buf[dtf::bufsize];
+                const auto n = dtf::to_chars(buf, t, f);
+                std::uint64_t res = ~0ull;
+                assert(dtf::from_chars(&res, buf, n, f) == dtf::error::ok);
+                assert(res == t - t % scale);
+            }
+        }
+
+        std::uint64_t res = 0;
+        assert(dtf::to_str(ts, dtf::msecs) == "1546966223006");
+        assert(dtf::from_chars(&res, dtf::to_str(ts, dtf::usecs), dtf::usecs) == dtf::error::ok);
+        assert(res == 1546966223006057000ull);
+
+        // every length
+        std::string str;
+        std::uint64_t exp = 0;
+        for ( std::size_t i = 1; i <= 19; ++i ) {
+            str.push_back(static_cast<char>('0' + i % 10));
+            exp = exp * 10 + i % 10;
+            assert(dtf::from_chars(&res, str, dtf::nsecs) == dtf::error::ok);
+            assert(res == exp);
+        }
+        assert(dtf::from_chars(&res, std::string{"18446744073709551615"}, dtf::nsecs) == dtf::error::ok);
+        assert(res == ~0ull);
+        assert(dtf::from_chars(&res, std::string{"18446744073709551616"}, dtf::nsecs) == dtf::error::number_out_of_range);
+        assert(dtf::from_chars(&res, std::string{"99999999999999999999"}, dtf::nsecs) == dtf::error::number_out_of_range);
+        assert(dtf::from_chars(&res, std::string{"100000000000000000000"}, dtf::nsecs) == dtf::error::number_out_of_range);
+        assert(dtf::from_chars(&res, std::string{"18446744073"}, dtf::secs) == dtf::error::ok);
+        assert(dtf::from_chars(&res, std::string{"18446744074"}, dtf::secs) == dtf::error::number_out_of_range);
+        assert(dtf::from_chars(&res, std::string{""}, dtf::secs) == dtf::error::wrong_number);
+        assert(dtf::from_chars(&res, std::string{"-1"}, dtf::secs) == dtf::error::wrong_number);
+        assert(dtf::from_chars(&res, std::string{"1546966223 "}, dtf::secs) == dtf::error::wrong_number);
+        assert(dtf::from_chars(&res, std::string{"15469662:3006"}, dtf::msecs) == dtf::error::wrong_number);
+        assert(dtf::from_chars(&res, std::string{"1546966223006/57057"}, dtf::nsecs) == dtf::error::wrong_number);
+        assert(dtf::from_chars(&res, std::string{"1546966223006057057a"}, dtf::nsecs) == dtf::error::wrong_number);
+        assert(dtf::from_chars(&res, std::string{"1546966223006057057ab"}, dtf::nsecs) == dtf::error::wrong_number);
+
+        const char *bufs[] = {"1546966223006", "1546966224006", "15469x6225006", "1546966226006"};
+        const std::size_t lens[] = {13, 13, 13, 13};
+        std::uint64_t tss[4]{};
+        assert(dtf::from_chars(tss, bufs, lens, 2, dtf::msecs) == 2);
+        assert(tss[0] == 1546966223006000000ull && tss[1] == 1546966224006000000ull);
+        assert(dtf::from_chars(tss, bufs, lens, 4, dtf::msecs) == 2);
+    }
+    std::cout << "DONE!" << std::endl;
+
+
+    std::cout << "Testing dtf::to_sortable_id_chars()/dtf::from_sortable_id_chars()..." << std::flush;
+    {
+        char buf[dtf::bufsize];
+        std::uint64_t res;
+        // the time part of the ULID
+        assert(dtf::to_sortable_id_chars(buf, 1469922850259ull, dtf::id_base32_48) == 10);
+        assert(std::string(buf, 10) == "01ARZ3NDEK");
+        assert(dtf::from_sortable_id_chars(&res, "01arz3ndek", 10, dtf::id_base32_48) == dtf::error::ok);
+        assert(res == 1469922850259ull);
+
+        assert(dtf::to_sortable_id_chars(buf, ~0ull, dtf::id_base32_64) == 13);
+        assert(std::string(buf, 13) == "FZZZZZZZZZZZZ");
+        assert(dtf::to_sortable_id_chars(buf, ~0ull, dtf::id_base36_64) == 13);
+        assert(std::string(buf, 13) == "3W5E11264SGSF");
+        assert(dtf::to_sortable_id_chars(buf, (1ull << 48) - 1, dtf::id_base36_48) == 10);
+        assert(std::string(buf, 10) == "2RRVTHNXTR");
+
+        // the round trip, the order and the batch form
+        const dtf::sortable_id fmts[] = {dtf::id_base32_48, dtf::id_base32_64, dtf::id_base36_48, dtf::id_base36_64};
+        std::vector<std::uint64_t> vals{0, 1, 31, 32, 35, 36, (1ull << 48) - 1};
+        std::uint64_t seed = 0x9E3779B97F4A7C15ull;
+        for ( std::size_t i = 0; i < 10000; ++i ) {
+            seed ^= seed << 13;
+            seed ^= seed >> 7;
+            seed ^= seed << 17;
+            vals.push_back(seed >> (seed % 64));
+        }
+        std::sort(vals.begin(), vals.end());
+        for ( const auto fmt: fmts ) {
+            const std::size_t size = dtf::sortable_id_size(fmt);
+            const bool is_48 = size == 10;
+            std::vector<std::uint64_t> src;
+            for ( const auto v: vals ) {
+                if ( !is_48 || v < (1ull << 48) ) {
+                    src.push_back(v);
+                }
+            }
+            std::vector<char> batch(src.size() * size);
+            assert(dtf::to_sortable_id_chars(batch.data(), src.data(), src.size(), fmt) == batch.size());
+
+            std::string prev;
+            for ( std::size_t i = 0; i < src.size(); ++i ) {
+                assert(dtf::to_sortable_id_chars(buf, src[i], fmt) == size);
+                const std::string id(buf, size);
+                assert(id.compare(0, size, batch.data() + i * size, size) == 0);
+                assert(prev <= id);
+                prev = id;
+                assert(dtf::from_sortable_id_chars(&res, buf, size, fmt) == dtf::error::ok);
+                assert(res == src[i]);
+            }
+        }
+
+        assert(dtf::from_sortable_id_chars(&res, "01ARZ3NDE", 9, dtf::id_base32_48) == dtf::error::too_short);
+        assert(dtf::from_sortable_id_chars(&res, "01ARZ3NDEKT", 11, dtf::id_base32_48) == dtf::error::too_long);
+        // Crockford's aliases, base32 only
+        assert(dtf::from_sortable_id_chars(&res, "OIARZ3NDEK", 10, dtf::id_base32_48) == dtf::error::ok && res == 1469922850259ull);
+        assert(dtf::from_sortable_id_chars(&res, "olARZ3NDEK", 10, dtf::id_base32_48) == dtf::error::ok && res == 1469922850259ull);
+        assert(dtf::from_sortable_id_chars(&res, "0LARZ3NDEK", 10, dtf::id_base32_48) == dtf::error::ok && res == 1469922850259ull);
+        assert(dtf::from_sortable_id_chars(&res, "0IARZ3NDEK", 10, dtf::id_base36_48) == dtf::error::ok && res != 1469922850259ull);
+        assert(dtf::from_sortable_id_chars(&res, "01ARZ3NDEU", 10, dtf::id_base32_48) == dtf::error::wrong_number);
+        assert(dtf::from_sortable_id_chars(&res, "01ARZ3ND\xC5K", 10, dtf::id_base32_48) == dtf::error::wrong_number);
+        assert(dtf::from_sortable_id_chars(&res, "01ARZ3ND-K", 10, dtf::id_base36_48) == dtf::error::wrong_number);
+        assert(dtf::from_sortable_id_chars(&res, "8000000000", 10, dtf::id_base32_48) == dtf::error::number_out_of_range);
+        assert(dtf::from_sortable_id_chars(&res, "2RRVTHNXTS", 10, dtf::id_base36_48) == dtf::error::number_out_of_range);
+        assert(dtf::from_sortable_id_chars(&res, "G000000000000", 13, dtf::id_base32_64) == dtf::error::number_out_of_range);
+        assert(dtf::from_sortable_id_chars(&res, "3W5E11264SGSG", 13, dtf::id_base36_64) == dtf::error::number_out_of_range);
+        assert(dtf::from_sortable_id_chars(&res, "ZZZZZZZZZZZZZ", 13, dtf::id_base36_64) == dtf::error::number_out_of_range);
+        assert(dtf::from_sortable_id_chars(&res, "3W5E11264SGSF", 13, dtf::id_base36_64) == dtf::error::ok && res == ~0ull);
+    }
+    std::cout << "DONE!" << std::endl;
+
+
+    std::cout << "Testing dtf::from_dt_chars()..." << std::flush;
+    {
+        for ( const auto &it: good_vals ) {
+            const std::uint64_t scale = (it.flags & dtf::secs)
+                ? 1000000000ull
+                : (it.flags & dtf::msecs)
+                    ? 1000000ull
+                    : (it.flags & dtf::usecs) ? 1000ull : 1ull
+            ;
+            std::uint64_t res = 0;
+            auto err = dtf::from_dt_chars(&res, it.exp_str, it.exp_len, it.flags);
+            assert(err == dtf::error::ok);
+            assert(res == ts - ts % scale);
+
+            // every ~11 hours through the whole supported range
+            for ( std::uint64_t ss = 0; ss <= 0xffffffffull; ss += 39999ull * 97ull ) {
+                const std::uint64_t t = ss * 1000000000ull + 123456789ull;
+                char buf[dtf::bufsize];
+                const auto n = dtf::to_dt_chars(buf, t, it.flags);
+                assert(dtf::from_dt_chars(&res, buf, n, it.flags) == dtf::error::ok);
+                assert(res == t - t % scale);
+            }
+        }
+
+        constexpr auto rfc3339 = dtf::yyyy_mm_dd | dtf::date_sep_dash | dtf::dt_sep_T | dtf::time_sep_colon | dtf::msecs;
+        std::uint64_t res = 0;
+        assert(dtf::from_dt_chars(&res, std::string{"2019-01-08T16:50:23.006Z"}, rfc3339 | dtf::zone_Z) == dtf::error::ok);
+        assert(res == 1546966223006000000ull);
+        assert(dtf::from_dt_chars(&res, std::string{"2019-01-08T22:20:23.006+05:30"}, rfc3339 | dtf::zone_offset) == dtf::error::ok);
+        assert(res == 1546966223006000000ull);
+        assert(dtf::from_dt_chars(&res, std::string{"2019-01-07T23:50:23.006-17:00"}, rfc3339 | dtf::zone_offset) == dtf::error::ok);
+        assert(res == 1546966223006000000ull);
+
+        assert(dtf::from_dt_chars(&res, std::string{"2019-01-08T16:50:23.006"}, rfc3339 | dtf::zone_Z) == dtf::error::dt_mismatch);
+        assert(dtf::from_dt_chars(&res, std::string{"2019-01-08T16:50:23.0060"}, rfc3339) == dtf::error::dt_mismatch);
+        assert(dtf::from_dt_chars(&res, std::string{"2019.01-08T16:50:23.006"}, rfc3339) == dtf::error::dt_mismatch);
+        assert(dtf::from_dt_chars(&res, std::string{"2019-01-08 16:50:23.006"}, rfc3339) == dtf::error::dt_mismatch);
+        assert(dtf::from_dt_chars(&res, std::string{"2019-01-08T16.50:23.006"}, rfc3339) == dtf::error::dt_mismatch);
+        assert(dtf::from_dt_chars(&res, std::string{"2019-01-08T16:50:23,006"}, rfc3339) == dtf::error::dt_mismatch);
+        assert(dtf::from_dt_chars(&res, std::string{"2019-01-08T16:5x:23.006"}, rfc3339) == dtf::error::dt_mismatch);
+        assert(dtf::from_dt_chars(&res, std::string{"2019-01-08T16:50:23.006+0530"}, rfc3339 | dtf::zone_offset) == dtf::error::dt_mismatch);
+        assert(dtf::from_dt_chars(&res, std::string{"2019-01-08T16:50:23.006+24:00"}, rfc3339 | dtf::zone_offset) == dtf::error::wrong_zone_offset);
+        assert(dtf::from_dt_chars(&res, std::string{"2019-13-08T16:50:23.006"}, rfc3339) == dtf::error::wrong_dt_value);
+        assert(dtf::from_dt_chars(&res, std::string{"2019-02-29T16:50:23.006"}, rfc3339) == dtf::error::wrong_dt_value);
+        assert(dtf::from_dt_chars(&res, std::string{"2020-02-29T16:50:23.006"}, rfc3339) == dtf::error::ok);
+        assert(dtf::from_dt_chars(&res, std::string{"2019-01-08T24:50:23.006"}, rfc3339) == dtf::error::wrong_dt_value);
+        assert(dtf::from_dt_chars(&res, std::string{"1969-12-31T23:59:59.999"}, rfc3339) == dtf::error::wrong_dt_value);
+        assert(dtf::from_dt_chars(&res, std::string{"1970-01-01T00:00:00.000"}, rfc3339) == dtf::error::ok && res == 0);
+        assert(dtf::from_dt_chars(&res, std::string{"2554-07-21T23:34:33.709"}, rfc3339) == dtf::error::ok);
+        assert(dtf::from_dt_chars(&res, std::string{"2554-07-21T23:34:33.710"}, rfc3339) == dtf::error::wrong_dt_value);
+    }
+    std::cout << "DONE!" << std::endl;
+
+
+    std::cout << "Testing dtf::to_dt_chars() with dtf::context/dtf::no_cache..." << std::flush;
+    {
+        dtf::context ctx;
+        for ( const auto &it: good_vals ) {
+            for ( const std::uint64_t t: {ts, ts + 1, ts + 86400ull * 1000000000ull, ts - 3600ull * 1000000000ull} ) {
+                char exp[dtf::bufsize], buf0[dtf::bufsize], buf1[dtf::bufsize];
+                const auto n = dtf::to_dt_chars(exp, t, it.flags);
+                assert(dtf::to_dt_chars(buf0, t, it.flags, ctx) == n);
+                assert(std::memcmp(buf0, exp, n) == 0);
+                assert(dtf::to_dt_chars(buf1, t, it.flags, dtf::no_cache) == n);
+                assert(std::memcmp(buf1, exp, n) == 0);
+            }
+        }
+
+        constexpr auto flags = dtf::yyyy_mm_dd | dtf::date_sep_dash | dtf::dt_sep_T | dtf::time_sep_colon | dtf::secs | dtf::zone_offset;
+        char buf[dtf::bufsize];
+        auto n = dtf::to_dt_chars(buf, ts, flags, -90, ctx);
+        assert(std::string(buf, n) == "2019-01-08T15:20:23-01:30");
+        n = dtf::to_dt_chars(buf, ts, flags, -90, dtf::no_cache);
+        assert(std::string(buf, n) == "2019-01-08T15:20:23-01:30");
+
+        const auto f = dtf::to_fields(ts, dtf::no_cache);
+        const auto f_ctx = dtf::to_fields(ts, ctx);
+        assert(std::memcmp(&f, &f_ctx, sizeof(f)) == 0);
+        assert(f.year == 2019 && f.month == 1 && f.day == 8 && f.secs == 23 && f.nsecs == 6057057);
+    }
+    std::cout << "DONE!" << std::endl;
+
+
+    std::cout << "Testing dtf::to_dt_chars() with dtf::tables..." << std::flush;
+    {
+        // the tables are built around the current day, both inside and outside of the window
+        assert(dtf::tables_memory() == 0);
+        const std::uint64_t now = dtf::timestamp();
+        const std::uint64_t day = 86400ull * 1000000000ull;
+        for ( const auto &it: good_vals ) {
+            for ( std::uint64_t step = 0; step < 6000; step += 37 ) {
+                for ( const std::uint64_t t: {now - 3000 * day + step * day + step * 1000003ull, ts + step * 7777777777ull} ) {
+                    char exp[dtf::bufsize], buf[dtf::bufsize];
+                    const auto n = dtf::to_dt_chars(exp, t, it.flags, dtf::no_cache);
+                    assert(dtf::to_dt_chars(buf, t, it.flags, dtf::tables) == n);
+                    assert(std::memcmp(buf, exp, n) == 0);
+                }
+            }
+        }
+        // the time separator styles and the date styles
+        assert(dtf::tables_memory() >= 3 * 86400 * 8 + 6 * (2 * DTF_TABLES_DAYS + 1) * 10);
+
+        constexpr auto flags = dtf::yyyy_mm_dd | dtf::date_sep_dash | dtf::dt_sep_T | dtf::time_sep_colon | dtf::msecs | dtf::zone_offset;
+        for ( const int offset: {-90, 0, 330} ) {
+            char exp[dtf::bufsize], buf[dtf::bufsize];
+            const auto n = dtf::to_dt_chars(exp, now, flags, offset);
+            assert(dtf::to_dt_chars(buf, now, flags, offset, dtf::tables) == n);
+            assert(std::memcmp(buf, exp, n) == 0);
+        }
+    }
+    std::cout << "DONE!" << std::endl;
+
+
+    std::cout << "Testing dtf::to_dt_column()..." << std::flush;
+    {
+        std::vector<std::uint64_t> tss;
+        for ( std::uint64_t i = 0; i < 100; ++i ) {
+            tss.push_back(ts + i * 3593ull * 1000000007ull);
+        }
+        for ( const auto &it: good_vals ) {
+            const auto len = dtf::dt_chars_size(it.flags);
+            assert(len == it.exp_len);
+
+            // appended to the existing column of 3 chars
+            std::vector<char> data(3 + tss.size() * len);
+            std::vector<std::int32_t> offsets32(tss.size() + 1);
+            std::vector<std::int64_t> offsets64(tss.size() + 1);
+            offsets32[0] = 3;
+            offsets64[0] = 3;
+            assert(dtf::to_dt_column(data.data(), offsets64.data(), tss.data(), tss.size(), it.flags) == tss.size() * len);
+            const std::vector<char> data64 = data;
+            assert(dtf::to_dt_column(data.data(), offsets32.data(), tss.data(), tss.size(), it.flags) == tss.size() * len);
+            assert(data == data64);
+
+            for ( std::size_t i = 0; i < tss.size(); ++i ) {
+                assert(offsets32[i] == offsets64[i]);
+                const auto row = std::string(data.data() + offsets32[i], data.data() + offsets32[i + 1]);
+                assert(row == dtf::to_dt_str(tss[i], it.flags));
+            }
+            assert(offsets32.back() == static_cast<std::int32_t>(data.size()));
+        }
+        constexpr auto rfc3339 = dtf::yyyy_mm_dd | dtf::date_sep_dash | dtf::dt_sep_T | dtf::time_sep_colon | dtf::nsecs;
+        assert(dtf::dt_chars_size(rfc3339 | dtf::zone_offset) == dtf::to_dt_str(ts, rfc3339 | dtf::zone_offset).size());
+        assert(dtf::dt_chars_size(rfc3339 | dtf::zone_Z) == dtf::to_dt_str(ts, rfc3339 | dtf::zone_Z).size());
+
+        // the empty column
+        std::int32_t offsets[1] = {7};
+        assert(dtf::to_dt_column(nullptr, offsets, tss.data(), 0, rfc3339) == 0 && offsets[0] == 7);
+    }
+    std::cout << "DONE!" << std::endl;
+
+
+    std::cout << "Testing dtf::get_formatter()..." << std::flush;
+    {
+        for ( const auto &it: good_vals ) {
+            const dtf::formatter func = dtf::get_formatter(it.flags);
+            assert(func);
+            char buf[dtf::bufsize];
+            const auto n = func(buf, ts);
+            assert(n == it.exp_len && std::memcmp(buf, it.exp_str, n) == 0);
+            assert(dtf::to_dt_chars_dispatch(buf, ts, it.flags) == n);
+            assert(std::memcmp(buf, it.exp_str, n) == 0);
+        }
+
+        // the invalid combinations
+        assert(dtf::get_formatter(0) == nullptr);
+        assert(dtf::get_formatter(dtf::yyyy_mm_dd | dtf::date_sep_empty | dtf::dt_sep_space | dtf::time_sep_colon | dtf::secs) == nullptr);
+        assert(dtf::get_formatter(dtf::yyyy_mm_dd | dtf::dd_mm_yyyy | dtf::date_sep_dash | dtf::dt_sep_T | dtf::time_sep_colon | dtf::secs) == nullptr);
+        assert(dtf::get_formatter(dtf::default_flags | dtf::zone_Z | dtf::zone_offset) == nullptr);
+        assert(dtf::get_formatter(dtf::default_flags | (1u << 31)) == nullptr);
+        assert(dtf::get_formatter(dtf::default_flags) != nullptr);
+
+        char buf[dtf::bufsize];
+        const auto n = dtf::to_dt_chars_fixed<dtf::default_flags>(buf, ts);
+        assert(std::string(buf, n) == "2019-01-08/16:50:23.006");
+    }
+    std::cout << "DONE!" << std::endl;
+
+
+    std::cout << "Testing dtf::to_dt_chars() with zone offset..." << std::flush;
+    {
+        constexpr auto rfc3339 = dtf::yyyy_mm_dd | dtf::date_sep_dash | dtf::dt_sep_T | dtf::time_sep_colon | dtf::msecs;
+        assert(dtf::to_dt_str(ts, rfc3339 | dtf::zone_Z) == "2019-01-08T16:50:23.006Z");
+        assert(dtf::to_dt_str(ts, rfc3339 | dtf::zone_offset) == "2019-01-08T16:50:23.006+00:00");
+        assert(dtf::to_dt_str(ts, rfc3339 | dtf::zone_offset, 5 * 60 + 30) == "2019-01-08T22:20:23.006+05:30");
+        assert(dtf::to_dt_str(ts, rfc3339 | dtf::zone_offset, -17 * 60) == "2019-01-07T23:50:23.006-17:00");
+        // the offset is applied without the designator
+        assert(dtf::to_dt_str(ts, rfc3339, 60) == "2019-01-08T17:50:23.006");
+
+        std::uint32_t flags{};
+        assert(dtf::get_flags(&flags, std::string{"2019-01-07T23:50:23.006-17:00"}) == dtf::error::ok);
+        assert(flags == (rfc3339 | dtf::zone_offset));
+        assert(dtf::get_flags(&flags, std::string{"20190108T165023Z"}) == dtf::error::ok);
+        assert(flags == (dtf::yyyy_mm_dd | dtf::date_sep_empty | dtf::dt_sep_T | dtf::time_sep_empty | dtf::secs | dtf::zone_Z));
+    }
+    std::cout << "DONE!" << std::endl;
+
+
+    std::cout << "Testing dtf::to_fields()/dtf::from_fields()..." << std::flush;
+    {
+        auto f = dtf::to_fields(ts);
+        assert(f.year == 2019 && f.month == 1 && f.day == 8);
+        assert(f.hours == 16 && f.mins == 50 && f.secs == 23 && f.nsecs == 6057057);
+        assert(f.wday == 2 && f.yday == 7);
+        assert(dtf::from_fields(f) == ts);
+
+        // compare with gmtime() every ~11 hours through the whole supported range
+        for ( std::uint64_t ss = 0; ss <= 0xffffffffull; ss += 39999ull ) {
+            const std::time_t tt = static_cast<std::time_t>(ss);
+            const struct tm tmv = *std::gmtime(&tt);
+
+            f = dtf::to_fields(ss * 1000000000ull + 1);
+            assert(f.year  == static_cast<std::uint32_t>(tmv.tm_year + 1900));
+            assert(f.month == static_cast<std::uint32_t>(tmv.tm_mon + 1));
+            assert(f.day   == static_cast<std::uint32_t>(tmv.tm_mday));
+            assert(f.hours == static_cast<std::uint32_t>(tmv.tm_hour));
+            assert(f.mins  == static_cast<std::uint32_t>(tmv.tm_min));
+            assert(f.secs  == static_cast<std::uint32_t>(tmv.tm_sec));
+            assert(f.nsecs == 1);
+            assert(f.wday  == static_cast<std::uint32_t>(tmv.tm_wday));
+            assert(f.yday  == static_cast<std::uint32_t>(tmv.tm_yday));
+
+            assert(dtf::from_fields(f) == ss * 1000000000ull + 1);
+        }
+    }
+    std::cout << "DONE!" << std::endl;
+
+
+    std::cout << "Testing dtf::packed_dt..." << std::flush;
+    {
+        const auto pdt = dtf::to_packed(ts);
+        assert(pdt.value == 0x2019010816502300ull);
+        assert(dtf::from_packed(pdt) == ts - 6057057);
+
+        // the same strings as the timestamp truncated to 1/100 s, and the same order
+        std::vector<std::uint64_t> tss;
+        std::uint64_t seed = 0x9E3779B97F4A7C15ull;
+        for ( std::size_t i = 0; i < 10000; ++i ) {
+            seed ^= seed << 13;
+            seed ^= seed >> 7;
+            seed ^= seed << 17;
+            tss.push_back(seed % 0xffffffffull * 1000000000ull + seed % 1000000000ull);
+        }
+        std::sort(tss.begin(), tss.end());
+        for ( std::size_t i = 0; i < tss.size(); ++i ) {
+            const std::uint64_t truncated = tss[i] - tss[i] % 10000000ull;
+            const auto packed = dtf::to_packed(tss[i]);
+            assert(dtf::from_packed(packed) == truncated);
+            assert(i == 0 || dtf::to_packed(tss[i - 1]) <= packed);
+            for ( const auto &it: good_vals ) {
+                char exp[dtf::bufsize], buf[dtf::bufsize];
+                const auto n = dtf::to_dt_chars(exp, truncated, it.flags);
+                assert(dtf::to_dt_chars(buf, packed, it.flags) == n);
+                assert(std::memcmp(buf, exp, n) == 0);
+            }
+        }
+
+        constexpr auto flags = dtf::yyyy_mm_dd | dtf::date_sep_dash | dtf::dt_sep_T | dtf::time_sep_colon | dtf::nsecs | dtf::zone_offset;
+        char buf[dtf::bufsize];
+        const auto n = dtf::to_dt_chars(buf, pdt, flags);
+        assert(std::string(buf, n) == "2019-01-08T16:50:23.000000000+00:00");
+    }
+    std::cout << "DONE!" << std::endl;
+
+
+    std::cout << "Testing dtf::sort_key()..." << std::flush;
+    {
+        std::vector<std::uint64_t> tss;
+        std::uint64_t seed = 0x2545F4914F6CDD1Dull;
+        for ( std::size_t i = 0; i < 10000; ++i ) {
+            seed ^= seed << 13;
+            seed ^= seed >> 7;
+            seed ^= seed << 17;
+            tss.push_back(seed % 0xffffffffull * 1000000000ull + seed % 1000000000ull);
+        }
+        std::sort(tss.begin(), tss.end());
+        for ( const auto &it: good_vals ) {
+            // the resolution of the string
+            const std::uint64_t res = (it.flags & dtf::secs) ? 1000000000ull : (it.flags & dtf::msecs) ? 1000000ull : 1ull;
+            char prev[dtf::sort_key_size] = {};
+            for ( const std::uint64_t t: tss ) {
+                char str[dtf::bufsize], key[dtf::sort_key_size];
+                const auto n = dtf::to_dt_chars(str, t, it.flags);
+                assert(dtf::sort_key(str, n, it.flags) == dtf::to_packed(t - t % res));
+
+                // the big-endian packed key followed by the rest of the fraction
+                dtf::sort_key(key, str, n, it.flags);
+                const std::uint64_t packed = dtf::to_packed(t - t % res).value;
+                for ( std::size_t i = 0; i < 8; ++i ) {
+                    assert(static_cast<unsigned char>(key[i]) == ((packed >> (56 - i * 8)) & 0xFF));
+                }
+                assert(std::memcmp(prev, key, sizeof(key)) <= 0);
+                std::memcpy(prev, key, sizeof(key));
+
+                // the same as the first 8 bytes
+                char key8[dtf::short_sort_key_size];
+                dtf::short_sort_key(key8, str, n, it.flags);
+                assert(std::memcmp(key8, key, sizeof(key8)) == 0);
+            }
+        }
+
+        // the full precision
+        static const char exp[dtf::sort_key_size] = {
+            0x20, 0x19, 0x01, 0x08, 0x16, 0x50, 0x23, 0x00, 0x60, 0x57, 0x05, 0x70, 0x00, 0x00, 0x00, 0x00
+        };
+        constexpr auto flags = dtf::dd_mm_yyyy | dtf::date_sep_point | dtf::dt_sep_space | dtf::time_sep_colon | dtf::nsecs;
+        char key[dtf::sort_key_size];
+        dtf::sort_key(key, "08.01.2019 16:50:23.006057057", 29, flags);
+        assert(std::memcmp(key, exp, sizeof(key)) == 0);
+    }
+    std::cout << "DONE!" << std::endl;
+
+
+    std::cout << "Testing dtf::civil_cache..." << std::flush;
+    {
+        const auto equal = [](const dtf::civil_time &l, const dtf::civil_time &r) {
+            return std::memcmp(&l, &r, sizeof(l)) == 0;
+        };
+
+        static dtf::civil_cache<4> cache{};
+        const std::uint32_t base = 1546966223u; // 2019-01-08 16:50:23
+        // the last two are on the same day as the first
+        const std::uint32_t secs[] = {base, base + 86400u * 40, base - 86400u * 3, base + 86400u * 800, base + 1, base + 60};
+        bool hit = true;
+        for ( std::size_t i = 0; i < 4; ++i ) {
+            dtf::civil_time exp;
+            dtf::civil_from_secs(&exp, secs[i]);
+            assert(equal(cache.get(secs[i], &hit), exp));
+            assert(!hit);
+        }
+        // all of them are cached now, in any order
+        for ( std::size_t i: {3, 0, 2, 1, 1, 3} ) {
+            dtf::civil_time exp;
+            dtf::civil_from_secs(&exp, secs[i]);
+            assert(equal(cache.get(secs[i], &hit), exp));
+            assert(hit);
+        }
+        // the misses of the cached day
+        for ( std::size_t i: {4, 5} ) {
+            dtf::civil_time exp;
+            dtf::civil_from_secs(&exp, secs[i]);
+            assert(equal(cache.get(secs[i], &hit), exp));
+            assert(!hit);
+        }
+        // the most recently used is never evicted
+        cache.get(secs[5], &hit);
+        assert(hit);
+
+        // the interleaved sources through the default per-thread cache
+        for ( std::uint32_t k = 1; k <= 9; ++k ) {
+            for ( std::uint32_t i = 0; i < 10000; ++i ) {
+                const std::uint32_t ss = base + (i % k) * 3593u + i / k;
+                const std::time_t tt = static_cast<std::time_t>(ss);
+                const struct tm tmv = *std::gmtime(&tt);
+
+                const auto f = dtf::to_fields(ss * 1000000000ull);
+                assert(f.year == static_cast<std::uint32_t>(tmv.tm_year + 1900));
+                assert(f.month == static_cast<std::uint32_t>(tmv.tm_mon + 1));
+                assert(f.day == static_cast<std::uint32_t>(tmv.tm_mday));
+                assert(f.hours == static_cast<std::uint32_t>(tmv.tm_hour));
+                assert(f.mins == static_cast<std::uint32_t>(tmv.tm_min));
+                assert(f.secs == static_cast<std::uint32_t>(tmv.tm_sec));
+                assert(f.wday == static_cast<std::uint32_t>(tmv.tm_wday));
+                assert(f.yday == static_cast<std::uint32_t>(tmv.tm_yday));
+            }
+        }
+    }
+    std::cout << "DONE!" << std::endl;
+
+
+    std::cout << "Testing dtf::floor_to()/dtf::ceil_to()..." << std::flush;
+    {
+        // 2019-01-08 16:50:23.006057057, Tuesday
+        assert(dtf::to_dt_str(dtf::floor_to(dtf::unit_second, ts)) == "2019-01-08/16:50:23.000");
+        assert(dtf::to_dt_str(dtf::floor_to(dtf::unit_minute, ts)) == "2019-01-08/16:50:00.000");
+        assert(dtf::to_dt_str(dtf::floor_to(dtf::unit_hour, ts)) == "2019-01-08/16:00:00.000");
+        assert(dtf::to_dt_str(dtf::floor_to(dtf::unit_day, ts)) == "2019-01-08/00:00:00.000");
+        assert(dtf::to_dt_str(dtf::floor_to(dtf::unit_week, ts)) == "2019-01-07/00:00:00.000");
+        assert(dtf::to_dt_str(dtf::floor_to(dtf::unit_month, ts)) == "2019-01-01/00:00:00.000");
+        assert(dtf::to_dt_str(dtf::floor_to(dtf::unit_year, ts)) == "2019-01-01/00:00:00.000");
+
+        assert(dtf::to_dt_str(dtf::ceil_to(dtf::unit_second, ts)) == "2019-01-08/16:50:24.000");
+        assert(dtf::to_dt_str(dtf::ceil_to(dtf::unit_minute, ts)) == "2019-01-08/16:51:00.000");
+        assert(dtf::to_dt_str(dtf::ceil_to(dtf::unit_hour, ts)) == "2019-01-08/17:00:00.000");
+        assert(dtf::to_dt_str(dtf::ceil_to(dtf::unit_day, ts)) == "2019-01-09/00:00:00.000");
+        assert(dtf::to_dt_str(dtf::ceil_to(dtf::unit_week, ts)) == "2019-01-14/00:00:00.000");
+        assert(dtf::to_dt_str(dtf::ceil_to(dtf::unit_month, ts)) == "2019-02-01/00:00:00.000");
+        assert(dtf::to_dt_str(dtf::ceil_to(dtf::unit_year, ts)) == "2020-01-01/00:00:00.000");
+
+        // the aligned values are kept as is
+        const std::uint64_t feb29 = dtf::from_fields(dtf::fields{2020, 2, 29, 0, 0, 0, 0, 0, 0});
+        assert(dtf::ceil_to(dtf::unit_day, feb29) == feb29);
+        assert(dtf::floor_to(dtf::unit_day, feb29) == feb29);
+        assert(dtf::to_dt_str(dtf::ceil_to(dtf::unit_month, feb29)) == "2020-03-01/00:00:00.000");
+        assert(dtf::ceil_to(dtf::unit_month, dtf::ceil_to(dtf::unit_month, feb29)) == dtf::ceil_to(dtf::unit_month, feb29));
+        // the first days of epoch are rounded up to the first Monday
+        assert(dtf::to_dt_str(dtf::ceil_to(dtf::unit_week, 1)) == "1970-01-05/00:00:00.000");
+
+        // the batch versions against the single ones, every ~7 hours through 1970-2100
+        std::vector<std::uint64_t> src, dst;
+        for ( std::uint64_t ss = 4 * 86400; ss < 4102444800ull; ss += 25013ull ) {
+            src.push_back(ss * 1000000000ull + 7);
+        }
+        for ( auto u: {dtf::unit_second, dtf::unit_minute, dtf::unit_hour, dtf::unit_day
+            ,dtf::unit_week, dtf::unit_month, dtf::unit_year} )
+        {
+            dst.assign(src.size(), 0);
+            dtf::floor_to(u, dst.data(), src.data(), src.size());
+            for ( std::size_t i = 0; i < src.size(); ++i ) {
+                assert(dst[i] == dtf::floor_to(u, src[i]));
+                assert(dst[i] <= src[i]);
+            }
+            dtf::ceil_to(u, dst.data(), src.data(), src.size());
+            for ( std::size_t i = 0; i < src.size(); ++i ) {
+                assert(dst[i] == dtf::ceil_to(u, src[i]));
+                assert(dst[i] >= src[i]);
+            }
+        }
+
+        // the calendar buckets against the fields
+        for ( const auto it: src ) {
+            auto f = dtf::to_fields(it);
+            const std::uint64_t month_beg = dtf::from_fields(dtf::fields{f.year, f.month, 1, 0, 0, 0, 0, 0, 0});
+            const std::uint64_t year_beg = dtf::from_fields(dtf::fields{f.year, 1, 1, 0, 0, 0, 0, 0, 0});
+            const std::uint64_t day_beg = dtf::from_fields(dtf::fields{f.year, f.month, f.day, 0, 0, 0, 0, 0, 0});
+            assert(dtf::floor_to(dtf::unit_month, it) == month_beg);
+            assert(dtf::floor_to(dtf::unit_year, it) == year_beg);
+            assert(dtf::floor_to(dtf::unit_week, it) == day_beg - ((f.wday + 6) % 7) * 86400000000000ull);
+            const auto next = dtf::to_fields(dtf::ceil_to(dtf::unit_month, it));
+            assert(next.day == 1 && next.month == f.month % 12 + 1);
+        }
+    }
+    std::cout << "DONE!" << std::endl;
+
+
+    std::cout << "Testing dtf::add_months()/dtf::add_years()/dtf::next_weekday()..." << std::flush;
+    {
+        const auto at = [](const char *str) {
+            std::uint64_t res = 0;
+            assert(dtf::from_dt_chars(&res, str, std::strlen(str)) == dtf::error::ok);
+            return res;
+        };
+        // the end of the month is clamped, the time of day is kept
+        assert(dtf::to_dt_str(dtf::add_months(at("2019-01-31/13:58:59.123"), 1)) == "2019-02-28/13:58:59.123");
+        assert(dtf::to_dt_str(dtf::add_months(at("2020-01-31/13:58:59.123"), 1)) == "2020-02-29/13:58:59.123");
+        assert(dtf::to_dt_str(dtf::add_months(at("2019-03-31/00:00:00.000"), -1)) == "2019-02-28/00:00:00.000");
+        assert(dtf::to_dt_str(dtf::add_months(at("2019-01-15/00:00:00.000"), -13)) == "2017-12-15/00:00:00.000");
+        assert(dtf::to_dt_str(dtf::add_months(at("2019-12-31/23:59:59.999"), 2)) == "2020-02-29/23:59:59.999");
+        assert(dtf::to_dt_str(dtf::add_months(at("1970-01-01/00:00:00.000"), 0)) == "1970-01-01/00:00:00.000");
+        assert(dtf::to_dt_str(dtf::add_years(at("2020-02-29/12:00:00.000"), 1)) == "2021-02-28/12:00:00.000");
+        assert(dtf::to_dt_str(dtf::add_years(at("2020-02-29/12:00:00.000"), 4)) == "2024-02-29/12:00:00.000");
+        assert(dtf::to_dt_str(dtf::add_years(at("2020-02-29/12:00:00.000"), -20)) == "2000-02-29/12:00:00.000");
+        assert(dtf::add_months(ts, 3) % 1000000000ull == ts % 1000000000ull);
+
+        assert(dtf::days_in_month(at("2019-02-10/00:00:00.000")) == 28);
+        assert(dtf::days_in_month(at("2000-02-10/00:00:00.000")) == 29);
+        assert(dtf::days_in_month(at("2100-02-10/00:00:00.000")) == 28);
+        assert(dtf::days_in_month(at("2019-12-31/23:59:59.999")) == 31);
+        assert(dtf::days_in_month(2019u, 4u) == 30);
+
+        // 2019-01-08 is Tuesday
+        assert(dtf::to_dt_str(dtf::next_weekday(ts, 3)) == "2019-01-09/16:50:23.006");
+        assert(dtf::to_dt_str(dtf::next_weekday(ts, 2)) == "2019-01-15/16:50:23.006");
+        assert(dtf::to_dt_str(dtf::next_weekday(ts, 1)) == "2019-01-14/16:50:23.006");
+        assert(dtf::to_dt_str(dtf::next_weekday(0, 4)) == "1970-01-08/00:00:00.000");
+
+        // compared with the fields, the batch forms with the scalar ones
+        // about 25 years, the pairs of the same day
+        std::vector<std::uint64_t> src, dst(2000);
+        for ( std::uint64_t i = 0; i < 1000; ++i ) {
+            src.push_back(ts + i * 7919ull * 100000000007ull);
+            src.push_back(src.back() + 3600ull * 1000000000ull);
+        }
+        for ( const std::int32_t n: {-25, -12, -1, 0, 1, 2, 11, 12, 13, 120} ) {
+            dtf::add_months(dst.data(), src.data(), src.size(), n);
+            for ( std::size_t i = 0; i < src.size(); ++i ) {
+                const auto f = dtf::to_fields(src[i]);
+                const std::int64_t months = static_cast<std::int64_t>(f.year) * 12 + (f.month - 1) + n;
+                const auto r = dtf::to_fields(dst[i]);
+                assert(r.year == months / 12 && r.month == months % 12 + 1);
+                assert(r.day == std::min(f.day, dtf::days_in_month(r.year, r.month)));
+                assert(dst[i] % 86400000000000ull == src[i] % 86400000000000ull);
+                assert(dst[i] == dtf::add_months(src[i], n));
+            }
+            dtf::add_years(dst.data(), src.data(), src.size(), n);
+            for ( std::size_t i = 0; i < src.size(); ++i ) {
+                assert(dst[i] == dtf::add_months(src[i], n * 12));
+            }
+        }
+        for ( std::uint32_t wday = 0; wday < 7; ++wday ) {
+            dtf::next_weekday(dst.data(), src.data(), src.size(), wday);
+            for ( std::size_t i = 0; i < src.size(); ++i ) {
+                const std::uint64_t days = (dst[i] - src[i]) / 86400000000000ull;
+                assert(dtf::to_fields(dst[i]).wday == wday && days >= 1 && days <= 7);
+                assert(dst[i] == dtf::next_weekday(src[i], wday));
+            }
+        }
+    }
+    std::cout << "DONE!" << std::endl;
+
+
+    std::cout << "Testing dtf::pattern..." << std::flush;
+    {
+        struct {
+            const char *fmt;
+            const char *exp;
+        } const pattern_vals[] = {
+             {"%Y-%m-%dT%H:%M:%S", "2019-01-08T16:50:23"}
+            ,{"%F %T.%3N", "2019-01-08 16:50:23.006"}
+            ,{"%T.%6N|%T.%9N|%N", "16:50:23.006057|16:50:23.006057057|006057057"}
+            ,{"%d/%b/%Y:%H:%M:%S %z", "08/Jan/2019:16:50:23 +0000"}
+            ,{"%b %e %H:%M:%S", "Jan  8 16:50:23"}
+            ,{"%a, %d %b %Y %H:%M:%S %Z", "Tue, 08 Jan 2019 16:50:23 GMT"}
+            ,{"%A %B %j %y %D %R", "Tuesday January 008 19 01/08/19 16:50"}
+            ,{"%I:%M %p", "04:50 PM"}
+            ,{"%s", "1546966223"}
+            ,{"%%%n%t%h", "%\n\tJan"}
+            ,{"no specs", "no specs"}
+            ,{"", ""}
+        };
+        for ( const auto &it: pattern_vals ) {
+            dtf::pattern pat;
+            auto err = pat.compile(it.fmt);
+            assert(err == dtf::error::ok);
+
+            auto str = pat.format(ts);
+            bool equal = str == it.exp;
+            if ( !equal ) {
+                std::cout
+                    << std::endl
+                    << "pattern : \"" << it.fmt << "\"" << std::endl
+                    << "expected: \"" << it.exp << "\"" << std::endl
+                    << "got     : \"" << str << "\"" << std::endl
+                ;
+                assert(equal);
+            }
+            assert(str.size() <= pat.max_size());
+        }
+
+        // the names of months and weekdays are variable length
+        dtf::pattern pat{"%A %B"};
+        for ( std::uint32_t day = 0; day < 366; ++day ) {
+            auto str = pat.format(ts + day * 86400ull * 1000000000ull);
+            assert(str.size() <= pat.max_size());
+        }
+        assert(pat.format(ts + 1 * 86400ull * 1000000000ull) == "Wednesday January");
+        assert(pat.format(ts + 240 * 86400ull * 1000000000ull) == "Thursday September");
+
+        dtf::pattern wrong;
+        assert(wrong.compile("%Q") == dtf::error::wrong_pattern_spec);
+        assert(wrong.compile("%5N") == dtf::error::wrong_pattern_spec);
+        assert(wrong.compile("%3S") == dtf::error::wrong_pattern_spec);
+        assert(wrong.compile("%") == dtf::error::wrong_pattern_spec);
+        assert(wrong.max_size() == 0);
+        std::string too_long(dtf::pattern::max_literals + 1, 'x');
+        assert(wrong.compile(too_long.c_str()) == dtf::error::pattern_too_long);
+        std::string too_many;
+        for ( auto i = 0u; i <= dtf::pattern::max_ops; ++i ) {
+            too_many += "%S";
+        }
+        assert(wrong.compile(too_many.c_str()) == dtf::error::pattern_too_long);
+    }
+    std::cout << "DONE!" << std::endl;
+
+
+    std::cout << "Testing dtf::pattern::parse()..." << std::flush;
+    {
+        static constexpr auto secs = ts - ts % 1000000000ull;
+        static constexpr auto msecs = ts - ts % 1000000ull;
+        struct {
+            const char *fmt;
+            std::uint64_t exp;
+        } const parse_vals[] = {
+             {"%Y-%m-%dT%H:%M:%S", secs}
+            ,{"%F %T.%3N", msecs}
+            ,{"%F %T.%9N", ts}
+            ,{"%d/%b/%Y:%H:%M:%S %z", secs}
+            ,{"%a, %d %b %Y %H:%M:%S %Z", secs}
+            ,{"%A, %B %e %Y %I:%M:%S %p", secs}
+            ,{"%D %T", secs}
+            ,{"%Y.%j %T", secs}
+            ,{"%s.%N", ts}
+        };
+        for ( const auto &it: parse_vals ) {
+            const dtf::pattern pat{it.fmt};
+            const auto str = pat.format(ts);
+
+            std::uint64_t res{};
+            auto err = pat.parse(&res, str);
+            bool equal = err == dtf::error::ok && res == it.exp;
+            if ( !equal ) {
+                std::cout
+                    << std::endl
+                    << "pattern : \"" << it.fmt << "\"" << std::endl
+                    << "string  : \"" << str << "\"" << std::endl
+                    << "error   : " << static_cast<unsigned>(err) << std::endl
+                    << "expected: " << it.exp << std::endl
+                    << "got     : " << res << std::endl
+                ;
+                assert(equal);
+            }
+        }
+
+        std::uint64_t res{};
+        // case insensitive names and the numeric zone offsets
+        const dtf::pattern clf{"%d/%b/%Y:%H:%M:%S %z"};
+        assert(clf.parse(&res, std::string{"08/JAN/2019:18:50:23 +0200"}) == dtf::error::ok && res == secs);
+        assert(clf.parse(&res, std::string{"08/jan/2019:15:20:23 -0130"}) == dtf::error::ok && res == secs);
+        assert(clf.parse(&res, std::string{"08/Jan/2019:16:50:23 +000"}) == dtf::error::pattern_mismatch);
+        assert(clf.parse(&res, std::string{"08/Jan/2019:16:50:23 +00000"}) == dtf::error::pattern_mismatch);
+        assert(clf.parse(&res, std::string{"08/Jax/2019:16:50:23 +0000"}) == dtf::error::pattern_mismatch);
+        assert(clf.parse(&res, std::string{"08-Jan/2019:16:50:23 +0000"}) == dtf::error::pattern_mismatch);
+        assert(clf.parse(&res, std::string{"32/Jan/2019:16:50:23 +0000"}) == dtf::error::wrong_pattern_value);
+        assert(clf.parse(&res, std::string{"29/Feb/2019:16:50:23 +0000"}) == dtf::error::wrong_pattern_value);
+        assert(clf.parse(&res, std::string{"29/Feb/2020:16:50:23 +0000"}) == dtf::error::ok);
+        assert(clf.parse(&res, std::string{"08/Jan/2019:24:50:23 +0000"}) == dtf::error::wrong_pattern_value);
+        assert(clf.parse(&res, std::string{"08/Jan/1969:16:50:23 +0000"}) == dtf::error::wrong_pattern_value);
+
+        // the full and the abbreviated names for `%B`
+        const dtf::pattern full{"%B %d %Y"};
+        assert(full.parse(&res, std::string{"September 05 2019"}) == dtf::error::ok);
+        assert(full.parse(&res, std::string{"Sep 05 2019"}) == dtf::error::ok);
+        assert(full.parse(&res, std::string{"May 05 2019"}) == dtf::error::ok);
+        assert(full.parse(&res, std::string{"Septem 05 2019"}) == dtf::error::pattern_mismatch);
+
+        // the year inference for syslog
+        const dtf::pattern syslog{"%b %e %H:%M:%S"};
+        assert(syslog.parse(&res, std::string{"Jan  8 16:50:23"}, ts) == dtf::error::ok && res == secs);
+        assert(syslog.parse(&res, std::string{"Feb  8 16:50:23"}, ts) == dtf::error::ok);
+        assert(dtf::pattern{"%Y"}.format(res) == "2019");
+        assert(syslog.parse(&res, std::string{"Dec 31 23:59:59"}, ts) == dtf::error::ok);
+        assert(dtf::pattern{"%F %T"}.format(res) == "2018-12-31 23:59:59");
+        assert(syslog.parse(&res, std::string{"Jan 8 16:50:23"}, ts) == dtf::error::pattern_mismatch);
+
+        // the time only
+        const dtf::pattern time{"%T"};
+        assert(time.parse(&res, std::string{"16:50:23"}, ts) == dtf::error::ok && res == secs);
+
+        // the timestamps out of the range of `std::uint64_t` nanoseconds
+        const dtf::pattern dt{"%Y-%m-%d %H:%M:%S.%N"};
+        assert(dt.parse(&res, std::string{"2554-07-21 23:34:33.709551615"}) == dtf::error::ok && res == ~0ull);
+        assert(dt.parse(&res, std::string{"2554-07-21 23:34:33.709551616"}) == dtf::error::wrong_pattern_value);
+        assert(dtf::pattern{"%Y-%m-%d %H:%M:%S"}.parse(&res, std::string{"9999-12-31 23:59:59"}) == dtf::error::wrong_pattern_value);
+        const dtf::pattern epoch{"%s.%N"};
+        assert(epoch.parse(&res, std::string{"18446744073.709551615"}) == dtf::error::ok && res == ~0ull);
+        assert(epoch.parse(&res, std::string{"18446744073.999999999"}) == dtf::error::wrong_pattern_value);
+        assert(epoch.parse(&res, std::string{"99999999999.000000000"}) == dtf::error::wrong_pattern_value);
+    }
+    std::cout << "DONE!" << std::endl;
+
+
+    std::cout << "Testing dtf::wall_mapper..." << std::flush;
+    {
+        // the simulated clocks: the wall clock runs `sim_ppm` faster than the monotonic one
+        static std::uint64_t sim_mono, sim_mono_step;
+        static std::int64_t sim_ppm;
+        static std::uint64_t sim_wall_base;
+        const auto mono = []() -> std::uint64_t {
+            sim_mono += sim_mono_step;
+            return sim_mono;
+        };
+        const auto wall = []() -> std::uint64_t {
+            return sim_wall_base + sim_mono + static_cast<std::uint64_t>(static_cast<std::int64_t>(sim_mono) * sim_ppm / 1000000);
+        };
+        const auto true_wall = [](std::uint64_t m) -> std::uint64_t {
+            return sim_wall_base + m + static_cast<std::uint64_t>(static_cast<std::int64_t>(m) * sim_ppm / 1000000);
+        };
+
+        for ( const std::int64_t ppm: {0, 500, -500, 100} ) {
+            for ( const std::uint64_t step: {0u, 1000u} ) {
+                sim_mono = 1000000000ull;
+                sim_mono_step = step;
+                sim_ppm = ppm;
+                sim_wall_base = ts;
+                dtf::wall_mapper mapper{mono, wall};
+
+                // every 10 ms through 10 seconds, resampled every second
+                for ( std::uint64_t i = 1; i <= 1000; ++i ) {
+                    sim_mono += 10000000ull;
+                    const std::uint64_t m = sim_mono;
+                    const std::uint64_t exp = true_wall(m);
+                    const std::uint64_t res = mapper.to_wall(m);
+                    const std::uint64_t err = res > exp ? res - exp : exp - res;
+                    assert(err <= mapper.max_error(m));
+                    if ( i % 100 == 0 ) {
+                        const std::uint64_t bound = mapper.max_error(m);
+                        const std::int64_t change = mapper.resample();
+                        const std::uint64_t jump = static_cast<std::uint64_t>(change < 0 ? -change : change);
+                        // the jump at resampling is within the bounds of both samples
+                        assert(jump <= bound + mapper.max_error(m));
+                    }
+                }
+                // just after the sample only the window and the slew of the few readings are left
+                assert(mapper.max_error(sim_mono) <= step / 2 + 5);
+            }
+        }
+
+        // the step of the wall clock is picked up by `resample()`
+        sim_mono_step = 0;
+        sim_ppm = 0;
+        dtf::wall_mapper mapper{mono, wall};
+        sim_wall_base += 3600ull * 1000000000ull;
+        assert(mapper.resample() == 3600ll * 1000000000ll);
+        assert(mapper.to_wall(sim_mono) == true_wall(sim_mono));
+
+        std::uint64_t src[3] = {sim_mono, sim_mono + 1, sim_mono + 2}, dst[3];
+        mapper.to_wall(dst, src, 3);
+        assert(dst[0] == true_wall(sim_mono) && dst[2] == dst[0] + 2);
+
+        // the real clocks
+        dtf::wall_mapper real;
+        const std::uint64_t beg = dtf::timestamp();
+        const std::uint64_t mono_now = dtf::wall_mapper::steady_now();
+        const std::uint64_t res = real.to_wall(mono_now);
+        const std::uint64_t end = dtf::timestamp();
+        assert(res + real.max_error(mono_now) >= beg && res <= end + real.max_error(mono_now));
+    }
+    std::cout << "DONE!" << std::endl;
+
+
+    std::cout << "Testing dtf::to_http_date_chars()..." << std::flush;
+    {
+        // the example from RFC 7231
+        assert(dtf::to_http_date_str(784111777ull * 1000000000ull) == "Sun, 06 Nov 1994 08:49:37 GMT");
+        assert(dtf::to_http_date_str(ts) == "Tue, 08 Jan 2019 16:50:23 GMT");
+
+        const dtf::pattern http{"%a, %d %b %Y %H:%M:%S GMT"};
+        dtf::http_date_cache cache;
+        for ( std::uint64_t i = 0; i < 100000; ++i ) {
+            // each second is formatted twice: the cache miss and the cache hit
+            const std::uint64_t t = ts + (i / 2) * 7919ull * 1000000000ull + i;
+            char buf[dtf::http_date_size];
+            auto n = dtf::to_http_date_chars(buf, t, cache);
+            assert(n == dtf::http_date_size);
+            assert(std::string(buf, n) == http.format(t));
+        }
+    }
+    std::cout << "DONE!" << std::endl;
+
     return 0;
 }
 
@@ -0,0 +1,246 @@
+// MIT License
+//
+// Copyright (c) 2019-2025 niXman (github dot nixman at pm dot me)
+// All rights reserved.
+//
+// This file is part of DTF(https://github.com/niXman/dtf) project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+// converts the column of the CSV file between the epoch numbers and the date-time strings.
+// the input is `mmap()`ed and split into the newline-aligned chunks which are converted
+// in parallel, the converted chunks are written in order.
+
+#include <dtf/dtf.hpp>
+
+#include "pipeline.hpp"
+
+#include <iostream>
+#include <vector>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+#include <unistd.h>
+
+/*************************************************************************************************/
+
+struct options {
+    bool reverse = false;  // date-time strings to numbers
+    std::size_t column = 0;
+    char delim = ',';
+    bool header = false;
+    std::uint32_t unit = dtf::nsecs; // of the numbers
+    std::uint32_t flags = 0;         // of the date-time strings, zero to detect
+    const char *input = nullptr;
+    dtf_tools::pipeline_options pipeline;
+};
+
+static void usage(const char *exename) {
+    std::cerr
+        << "usage: " << exename << " [options] <input> [output]" << std::endl
+        << "  -r         the date-time strings to the numbers (the numbers to the date-time strings by default)" << std::endl
+        << "  -c N       the column index, zero based (0)" << std::endl
+        << "  -d C       the fields delimiter (',')" << std::endl
+        << "  -H         the first line is the header" << std::endl
+        << "  -u UNIT    the unit of the numbers: secs|msecs|usecs|nsecs (nsecs)" << std::endl
+        << "  -f SAMPLE  the date-time format given by the sample string (\"2018-12-11T13:58:59.000000000Z\")," << std::endl
+        << "             with `-r` the format is detected from the fields when not specified" << std::endl
+        << "  -j N       the num of threads (all the cores)" << std::endl
+        << "  -k KIB     the size of chunk in KiB (4096)" << std::endl
+        << "  -s         report the scaling with the num of threads, nothing is written" << std::endl
+        << "the output is written to stdout when not specified." << std::endl
+        << "the fields before the column must not contain the quoted delimiters." << std::endl
+    ;
+}
+
+static bool parse_options(options *opts, int argc, char *const *argv) {
+    int opt;
+    while ( (opt = ::getopt(argc, argv, "rc:d:Hu:f:j:k:s")) != -1 ) {
+        switch ( opt ) {
+            case 'r': { opts->reverse = true; break; }
+            case 'c': { opts->column = std::strtoul(optarg, nullptr, 10); break; }
+            case 'd': {
+                if ( std::strlen(optarg) != 1 ) {
+                    return false;
+                }
+                opts->delim = optarg[0];
+                break;
+            }
+            case 'H': { opts->header = true; break; }
+            case 'u': {
+                if ( std::strcmp(optarg, "secs") == 0 ) {
+                    opts->unit = dtf::secs;
+                } else if ( std::strcmp(optarg, "msecs") == 0 ) {
+                    opts->unit = dtf::msecs;
+                } else if ( std::strcmp(optarg, "usecs") == 0 ) {
+                    opts->unit = dtf::usecs;
+                } else if ( std::strcmp(optarg, "nsecs") == 0 ) {
+                    opts->unit = dtf::nsecs;
+                } else {
+                    return false;
+                }
+                break;
+            }
+            case 'f': {
+                if ( dtf::get_flags(&opts->flags, optarg, std::strlen(optarg)) != dtf::error::ok ) {
+                    std::cerr << "wrong date-time sample: \"" << optarg << "\"" << std::endl;
+                    return false;
+                }
+                break;
+            }
+            case 'j': { opts->pipeline.threads = std::strtoul(optarg, nullptr, 10); break; }
+            case 'k': { opts->pipeline.chunk_size = std::strtoul(optarg, nullptr, 10) << 10u; break; }
+            case 's': { opts->pipeline.scaling = true; break; }
+            default: return false;
+        }
+    }
+    if ( optind == argc || argc - optind > 2 ) {
+        return false;
+    }
+
+    opts->input = argv[optind];
+    if ( argc - optind == 2 ) {
+        opts->pipeline.output = argv[optind + 1];
+    }
+    if ( !opts->reverse && !opts->flags ) {
+        opts->flags = dtf::yyyy_mm_dd|dtf::date_sep_dash|dtf::dt_sep_T|dtf::time_sep_colon|dtf::nsecs|dtf::zone_Z;
+    }
+
+    return opts->pipeline.chunk_size != 0;
+}
+
+/*************************************************************************************************/
+
+// converts the field in place of `dst`, returns the num of chars placed or zero on error.
+// `flags` is sticky: the format of the previous field is tried first, then it's detected.
+static std::size_t convert_field(char *dst, const char *field, std::size_t len, const options &opts, std::uint32_t *flags) {
+    std::uint64_t ts;
+    if ( !opts.reverse ) {
+        if ( dtf::from_chars(&ts, field, len, opts.unit) != dtf::error::ok ) {
+            return 0;
+        }
+
+        return dtf::to_dt_chars(dst, ts, *flags);
+    }
+
+    if ( !*flags || dtf::from_dt_chars(&ts, field, len, *flags) != dtf::error::ok ) {
+        std::uint32_t detected;
+        if ( opts.flags
+            || dtf::get_flags(&detected, field, len) != dtf::error::ok
+            || dtf::from_dt_chars(&ts, field, len, detected) != dtf::error::ok )
+        {
+            return 0;
+        }
+        *flags = detected;
+    }
+
+    return dtf::to_chars(dst, ts, opts.unit);
+}
+
+// converts the lines of `[beg, end)` into `out`.
+// the unchanged bytes between the fields are copied by one `memcpy()` per line.
+// returns the num of the fields which are not converted and copied as is.
+static std::size_t convert_chunk(std::vector<char> *out, const char *beg, const char *end, const options &opts) {
+    std::size_t errors = 0;
+    std::uint32_t flags = opts.flags;
+
+    out->resize(std::max(out->size(), static_cast<std::size_t>(end - beg) + dtf::bufsize));
+    char *o = out->data();
+
+    const char *pending = beg; // the start of the bytes which are not copied yet
+    for ( const char *p = beg; p != end; ) {
+        const char *eol = static_cast<const char *>(std::memchr(p, '\n', static_cast<std::size_t>(end - p)));
+        eol = eol ? eol : end;
+
+        const char *field = p;
+        for ( std::size_t col = 0; col < opts.column && field; ++col ) {
+            field = static_cast<const char *>(std::memchr(field, opts.delim, static_cast<std::size_t>(eol - field)));
+            field = field ? field + 1 : nullptr;
+        }
+        if ( field ) {
+            const char *field_end = static_cast<const char *>(
+                std::memchr(field, opts.delim, static_cast<std::size_t>(eol - field))
+            );
+            field_end = field_end ? field_end : (eol != field && eol[-1] == '\r') ? eol - 1 : eol;
+
+            o = dtf_tools::reserve(out, o, static_cast<std::size_t>(field - pending) + dtf::bufsize);
+            std::memcpy(o, pending, static_cast<std::size_t>(field - pending));
+            o += field - pending;
+            const std::size_t n = convert_field(o, field, static_cast<std::size_t>(field_end - field), opts, &flags);
+            if ( n ) {
+                o += n;
+                pending = field_end;
+            } else {
+                ++errors;
+                pending = field;
+            }
+        } else {
+            ++errors;
+        }
+
+        p = eol == end ? end : eol + 1;
+    }
+
+    o = dtf_tools::reserve(out, o, static_cast<std::size_t>(end - pending));
+    std::memcpy(o, pending, static_cast<std::size_t>(end - pending));
+    o += end - pending;
+    out->resize(static_cast<std::size_t>(o - out->data()));
+
+    return errors;
+}
+
+/*************************************************************************************************/
+
+int main(int argc, char *const *argv) {
+    options opts;
+    if ( !parse_options(&opts, argc, argv) ) {
+        const char *exename = std::strrchr(argv[0], '/');
+        usage(exename ? exename + 1 : argv[0]);
+
+        return EXIT_FAILURE;
+    }
+
+    const char *data;
+    std::size_t size;
+    if ( !dtf_tools::map_file(&data, &size, opts.input) ) {
+        return EXIT_FAILURE;
+    }
+
+    // the header is copied as is
+    std::size_t header_len = 0;
+    if ( opts.header ) {
+        const char *eol = static_cast<const char *>(std::memchr(data, '\n', size));
+        header_len = eol ? static_cast<std::size_t>(eol + 1 - data) : size;
+    }
+
+    std::size_t errors = 0;
+    const bool ok = dtf_tools::run_pipeline(&errors, opts.pipeline, data, size, header_len
+        ,[&opts](std::vector<char> *out, const char *beg, const char *end) {
+            return convert_chunk(out, beg, end, opts);
+        }
+    );
+    if ( errors ) {
+        std::cerr << errors << " field(s) are not converted and copied as is" << std::endl;
+    }
+
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/*************************************************************************************************/
@@ -0,0 +1,255 @@
+// MIT License
+//
+// Copyright (c) 2019-2025 niXman (github dot nixman at pm dot me)
+// All rights reserved.
+//
+// This file is part of DTF(https://github.com/niXman/dtf) project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+// rewrites the leading date-time of every line of the log into the one format.
+// the format of the lines may vary (the logs of the different sources), it's detected
+// by `dtf::get_flags_prefix()` and cached per chunk, so the lines of the same source are
+// only validated by `dtf::from_dt_chars()`. the rest of the lines is copied as is.
+
+#include <dtf/dtf.hpp>
+
+#include "pipeline.hpp"
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+#include <unistd.h>
+
+/*************************************************************************************************/
+
+struct options {
+    std::uint32_t flags = dtf::yyyy_mm_dd|dtf::date_sep_dash|dtf::dt_sep_T|dtf::time_sep_colon|dtf::msecs|dtf::zone_Z;
+    std::size_t generate = 0; // the size of the synthetic input in MiB
+    const char *input = nullptr;
+    dtf_tools::pipeline_options pipeline;
+};
+
+static void usage(const char *exename) {
+    std::cerr
+        << "usage: " << exename << " [options] <input> [output]" << std::endl
+        << "       " << exename << " [options] -G MIB" << std::endl
+        << "  -f SAMPLE  the target format given by the sample string (\"2018-12-11T13:58:59.000Z\")" << std::endl
+        << "  -j N       the num of threads (all the cores)" << std::endl
+        << "  -k KIB     the size of chunk in KiB (4096)" << std::endl
+        << "  -s         report the scaling with the num of threads, nothing is written" << std::endl
+        << "  -G MIB     report the scaling for the synthetic input of the mixed formats" << std::endl
+        << "the output is written to stdout when not specified." << std::endl
+        << "the lines without the leading date-time are copied as is." << std::endl
+    ;
+}
+
+static bool parse_options(options *opts, int argc, char *const *argv) {
+    int opt;
+    while ( (opt = ::getopt(argc, argv, "f:j:k:sG:")) != -1 ) {
+        switch ( opt ) {
+            case 'f': {
+                if ( dtf::get_flags(&opts->flags, optarg, std::strlen(optarg)) != dtf::error::ok ) {
+                    std::cerr << "wrong date-time sample: \"" << optarg << "\"" << std::endl;
+                    return false;
+                }
+                break;
+            }
+            case 'j': { opts->pipeline.threads = std::strtoul(optarg, nullptr, 10); break; }
+            case 'k': { opts->pipeline.chunk_size = std::strtoul(optarg, nullptr, 10) << 10u; break; }
+            case 's': { opts->pipeline.scaling = true; break; }
+            case 'G': { opts->generate = std::strtoul(optarg, nullptr, 10); break; }
+            default: return false;
+        }
+    }
+
+    if ( opts->generate ) {
+        opts->pipeline.scaling = true;
+        return optind == argc;
+    }
+    if ( optind == argc || argc - optind > 2 ) {
+        return false;
+    }
+
+    opts->input = argv[optind];
+    if ( argc - optind == 2 ) {
+        opts->pipeline.output = argv[optind + 1];
+    }
+
+    return opts->pipeline.chunk_size != 0;
+}
+
+/*************************************************************************************************/
+
+// the format of the latest line, most of the lines of the chunk are of the same source
+struct format_cache {
+    std::size_t len;
+    std::uint32_t flags;
+};
+
+// parses the leading date-time of the line. returns its length, or zero when there is no one.
+static std::size_t parse_prefix(std::uint64_t *ts, const char *p, std::size_t n, format_cache *cache) {
+    // the format of the previous line, unless the date-time is longer (the fraction or the zone follows)
+    const std::size_t len = cache->len;
+    if ( len && len <= n && dtf::from_dt_chars(ts, p, len, cache->flags) == dtf::error::ok ) {
+        const bool longer = len < n
+            && (p[len] == '.' || p[len] == 'Z' || (len + 6 <= n && (p[len] == '+' || p[len] == '-') && p[len + 3] == ':'))
+        ;
+        if ( !longer ) {
+            return len;
+        }
+    }
+
+    std::uint32_t flags;
+    std::size_t consumed;
+    if ( dtf::get_flags_prefix(&flags, &consumed, p, n) != dtf::error::ok
+        || dtf::from_dt_chars(ts, p, consumed, flags) != dtf::error::ok )
+    {
+        return 0;
+    }
+    cache->len = consumed;
+    cache->flags = flags;
+
+    return consumed;
+}
+
+// rewrites the lines of `[beg, end)` into `out`.
+// the rest of the line after the date-time and the lines without the date-time are copied
+// by one `memcpy()` per line. returns the num of the lines without the date-time.
+static std::size_t normalize_chunk(std::vector<char> *out, const char *beg, const char *end, std::uint32_t flags) {
+    std::size_t untouched = 0;
+    format_cache cache{0, 0};
+
+    out->resize(std::max(out->size(), static_cast<std::size_t>(end - beg) + dtf::bufsize));
+    char *o = out->data();
+
+    const char *pending = beg; // the start of the bytes which are not copied yet
+    for ( const char *p = beg; p != end; ) {
+        const char *eol = static_cast<const char *>(std::memchr(p, '\n', static_cast<std::size_t>(end - p)));
+        eol = eol ? eol : end;
+
+        std::uint64_t ts;
+        const std::size_t len = parse_prefix(&ts, p, static_cast<std::size_t>(eol - p), &cache);
+        if ( len ) {
+            o = dtf_tools::reserve(out, o, static_cast<std::size_t>(p - pending) + dtf::bufsize);
+            std::memcpy(o, pending, static_cast<std::size_t>(p - pending));
+            o += p - pending;
+            o += dtf::to_dt_chars(o, ts, flags);
+            pending = p + len;
+        } else {
+            ++untouched;
+        }
+
+        p = eol == end ? end : eol + 1;
+    }
+
+    o = dtf_tools::reserve(out, o, static_cast<std::size_t>(end - pending));
+    std::memcpy(o, pending, static_cast<std::size_t>(end - pending));
+    o += end - pending;
+    out->resize(static_cast<std::size_t>(o - out->data()));
+
+    return untouched;
+}
+
+/*************************************************************************************************/
+
+// the log of the sources of the different formats, in the runs of 1-64 lines of the same source
+static std::string generate(std::size_t size) {
+    static const std::uint32_t formats[] = {
+         dtf::dd_mm_yyyy|dtf::date_sep_point|dtf::dt_sep_space|dtf::time_sep_colon|dtf::secs
+        ,dtf::yyyy_mm_dd|dtf::date_sep_empty|dtf::dt_sep_T|dtf::time_sep_empty|dtf::secs
+        ,dtf::yyyy_mm_dd|dtf::date_sep_dash|dtf::dt_sep_underscore|dtf::time_sep_colon|dtf::msecs
+        ,dtf::yyyy_mm_dd|dtf::date_sep_dash|dtf::dt_sep_T|dtf::time_sep_colon|dtf::usecs|dtf::zone_Z
+        ,dtf::yyyy_mm_dd|dtf::date_sep_dash|dtf::dt_sep_space|dtf::time_sep_colon|dtf::msecs|dtf::zone_offset
+        ,dtf::dd_mm_yyyy|dtf::date_sep_dash|dtf::dt_sep_dash|dtf::time_sep_point|dtf::nsecs
+    };
+    static const char *messages[] = {
+         " [INFO] connection accepted from 10.0.0.1:51234"
+        ," [WARN] slow query: 1532 ms, SELECT * FROM events WHERE id = ?"
+        ," [DEBUG] cache hit"
+        ," [ERROR] upstream timed out (110: Connection timed out) while reading response header"
+    };
+
+    std::uint64_t seed = 0x2545F4914F6CDD1Dull;
+    const auto next_rand = [&seed]() {
+        seed ^= seed << 13;
+        seed ^= seed >> 7;
+        seed ^= seed << 17;
+        return seed;
+    };
+
+    std::string res;
+    res.reserve(size + 256);
+    std::uint64_t ts = dtf::timestamp();
+    while ( res.size() < size ) {
+        const std::uint32_t f = formats[next_rand() % (sizeof(formats) / sizeof(formats[0]))];
+        for ( std::size_t run = next_rand() % 64 + 1; run; --run ) {
+            ts += next_rand() % 100000000ull;
+            char buf[dtf::bufsize];
+            res.append(buf, dtf::to_dt_chars(buf, ts, f));
+            res.append(messages[next_rand() % (sizeof(messages) / sizeof(messages[0]))]);
+            res.push_back('\n');
+        }
+        // the continuation line of the multi-line message
+        res.append("    at handler.cpp:42\n");
+    }
+
+    return res;
+}
+
+/*************************************************************************************************/
+
+int main(int argc, char *const *argv) {
+    options opts;
+    if ( !parse_options(&opts, argc, argv) ) {
+        const char *exename = std::strrchr(argv[0], '/');
+        usage(exename ? exename + 1 : argv[0]);
+
+        return EXIT_FAILURE;
+    }
+
+    std::string synthetic;
+    const char *data;
+    std::size_t size;
+    if ( opts.generate ) {
+        synthetic = generate(opts.generate << 20u);
+        data = synthetic.data();
+        size = synthetic.size();
+    } else if ( !dtf_tools::map_file(&data, &size, opts.input) ) {
+        return EXIT_FAILURE;
+    }
+
+    std::size_t untouched = 0;
+    const bool ok = dtf_tools::run_pipeline(&untouched, opts.pipeline, data, size, 0
+        ,[&opts](std::vector<char> *out, const char *beg, const char *end) {
+            return normalize_chunk(out, beg, end, opts.flags);
+        }
+    );
+    if ( untouched ) {
+        std::cerr << untouched << " line(s) without the leading date-time are copied as is" << std::endl;
+    }
+
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/*************************************************************************************************/
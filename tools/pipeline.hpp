@@ -0,0 +1,264 @@
+// MIT License
+//
+// Copyright (c) 2019-2025 niXman (github dot nixman at pm dot me)
+// All rights reserved.
+//
+// This file is part of DTF(https://github.com/niXman/dtf) project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef __dtf__tools__pipeline_hpp
+#define __dtf__tools__pipeline_hpp
+
+// the line-oriented processing of the `mmap()`ed files shared by the tools:
+// the input is split into the newline-aligned chunks which are converted in parallel,
+// the converted chunks are written in order.
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <algorithm>
+#include <vector>
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace dtf_tools {
+
+/*************************************************************************************************/
+
+struct pipeline_options {
+    std::size_t threads = 0; // all the cores when zero
+    std::size_t chunk_size = 4u << 20u;
+    bool scaling = false;    // report the throughput for 1, 2, 4... threads, nothing is written
+    const char *output = "-";
+};
+
+// makes sure at least `n` bytes are available at `o` in `out`, returns the same position
+inline char* reserve(std::vector<char> *out, char *o, std::size_t n) {
+    const std::size_t used = static_cast<std::size_t>(o - out->data());
+    if ( used + n > out->size() ) {
+        out->resize(std::max(used + n, out->size() * 2));
+    }
+
+    return out->data() + used;
+}
+
+inline bool write_all(int fd, const char *p, std::size_t n) {
+    while ( n ) {
+        const ssize_t r = ::write(fd, p, n);
+        if ( r < 0 ) {
+            return false;
+        }
+        p += r;
+        n -= static_cast<std::size_t>(r);
+    }
+
+    return true;
+}
+
+// the chunks boundaries, moved forward to the next line
+inline std::vector<const char *> split(const char *beg, const char *end, std::size_t chunk_size) {
+    std::vector<const char *> bounds{beg};
+    for ( const char *p = beg; p != end; ) {
+        if ( static_cast<std::size_t>(end - p) <= chunk_size ) {
+            p = end;
+        } else {
+            const char *eol = static_cast<const char *>(
+                std::memchr(p + chunk_size, '\n', static_cast<std::size_t>(end - p - chunk_size))
+            );
+            p = eol ? eol + 1 : end;
+        }
+        bounds.push_back(p);
+    }
+
+    return bounds;
+}
+
+// the chunks are converted by `threads` workers in any order and written by the calling thread
+// in order. at most `2 * threads` chunks are in flight, so the buffers are reused.
+// `fd` is negative when nothing should be written.
+// `convert(std::vector<char> *out, const char *beg, const char *end)` returns the num of errors.
+template<typename F>
+bool process_chunks(std::size_t *errors, const std::vector<const char *> &bounds, std::size_t threads, int fd, F &&convert) {
+    const std::size_t num_chunks = bounds.size() - 1;
+    const std::size_t window = threads * 2;
+
+    struct slot {
+        std::vector<char> out;
+        std::size_t errors;
+        std::size_t ready; // the index of the converted chunk
+    };
+    std::vector<slot> slots(window);
+    for ( auto &it: slots ) {
+        it.ready = ~std::size_t{0};
+    }
+
+    std::atomic<std::size_t> next{0};
+    std::mutex mutex;
+    std::condition_variable cv_ready, cv_space;
+    std::size_t written = 0;
+
+    std::vector<std::thread> workers;
+    for ( std::size_t i = 0; i < threads; ++i ) {
+        workers.emplace_back([&]() {
+            for ( std::size_t idx = next++; idx < num_chunks; idx = next++ ) {
+                {
+                    std::unique_lock<std::mutex> lock{mutex};
+                    cv_space.wait(lock, [&]() { return idx < written + window; });
+                }
+
+                slot &s = slots[idx % window];
+                s.errors = convert(&s.out, bounds[idx], bounds[idx + 1]);
+
+                std::lock_guard<std::mutex> lock{mutex};
+                s.ready = idx;
+                cv_ready.notify_one();
+            }
+        });
+    }
+
+    bool ok = true;
+    *errors = 0;
+    for ( std::size_t idx = 0; idx < num_chunks; ++idx ) {
+        slot &s = slots[idx % window];
+        {
+            std::unique_lock<std::mutex> lock{mutex};
+            cv_ready.wait(lock, [&]() { return s.ready == idx; });
+        }
+
+        ok = ok && (fd < 0 || write_all(fd, s.out.data(), s.out.size()));
+        *errors += s.errors;
+
+        std::lock_guard<std::mutex> lock{mutex};
+        written = idx + 1;
+        cv_space.notify_all();
+    }
+
+    for ( auto &it: workers ) {
+        it.join();
+    }
+
+    return ok;
+}
+
+/*************************************************************************************************/
+
+// the read-only mapping of the whole file, `data` is never null
+inline bool map_file(const char **data, std::size_t *size, const char *fname) {
+    const int fd = ::open(fname, O_RDONLY);
+    struct stat st;
+    if ( fd < 0 || ::fstat(fd, &st) != 0 ) {
+        std::cerr << "can't open \"" << fname << "\": " << std::strerror(errno) << std::endl;
+
+        return false;
+    }
+
+    *data = "";
+    *size = static_cast<std::size_t>(st.st_size);
+    if ( *size ) {
+        void *addr = ::mmap(nullptr, *size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if ( addr == MAP_FAILED ) {
+            std::cerr << "can't mmap \"" << fname << "\": " << std::strerror(errno) << std::endl;
+            ::close(fd);
+
+            return false;
+        }
+        ::madvise(addr, *size, MADV_SEQUENTIAL);
+        *data = static_cast<const char *>(addr);
+    }
+    ::close(fd);
+
+    return true;
+}
+
+// converts `[data + prefix_len, data + size)` and writes it after the unchanged prefix (the header),
+// or reports the scaling. the throughput is reported to stderr.
+template<typename F>
+bool run_pipeline(std::size_t *errors, const pipeline_options &opts, const char *data, std::size_t size
+    ,std::size_t prefix_len, F &&convert)
+{
+    const std::size_t threads = opts.threads ? opts.threads : std::max(1u, std::thread::hardware_concurrency());
+    const auto bounds = split(data + prefix_len, data + size, opts.chunk_size);
+    const auto gbps = [size](double secs) {
+        return secs > 0 ? static_cast<double>(size) / secs / 1e9 : 0.0;
+    };
+
+    *errors = 0;
+    if ( opts.scaling ) {
+        double single = 0;
+        for ( std::size_t num = 1; ; num = std::min(num * 2, threads) ) {
+            const auto start = std::chrono::steady_clock::now();
+            process_chunks(errors, bounds, num, -1, convert);
+            const std::chrono::duration<double> secs = std::chrono::steady_clock::now() - start;
+            single = num == 1 ? secs.count() : single;
+
+            std::cerr << std::fixed << std::setprecision(2)
+                << std::setw(3) << num << " thread(s): " << std::setw(6) << gbps(secs.count()) << " GB/s, "
+                << "x" << single / secs.count() << std::endl
+            ;
+            if ( num == threads ) {
+                break;
+            }
+        }
+
+        return true;
+    }
+
+    const bool to_stdout = std::strcmp(opts.output, "-") == 0;
+    const int fd = to_stdout ? STDOUT_FILENO : ::open(opts.output, O_WRONLY|O_CREAT|O_TRUNC, 0644);
+    if ( fd < 0 ) {
+        std::cerr << "can't open \"" << opts.output << "\": " << std::strerror(errno) << std::endl;
+
+        return false;
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    bool ok = write_all(fd, data, prefix_len);
+    ok = ok && process_chunks(errors, bounds, threads, fd, convert);
+    const std::chrono::duration<double> secs = std::chrono::steady_clock::now() - start;
+    if ( !ok || (!to_stdout && ::close(fd) != 0) ) {
+        std::cerr << "can't write \"" << opts.output << "\": " << std::strerror(errno) << std::endl;
+
+        return false;
+    }
+
+    std::cerr << std::fixed << std::setprecision(2)
+        << size << " bytes in " << secs.count() << " s: " << gbps(secs.count()) << " GB/s, "
+        << threads << " thread(s)" << std::endl
+    ;
+
+    return true;
+}
+
+/*************************************************************************************************/
+
+} // ns dtf_tools
+
+#endif // __dtf__tools__pipeline_hpp